@@ -5,55 +5,74 @@ PROGRAMMER    : (C) Copyright 2010 by Peter C. Chapin <pcc482719@gmail.com>
 
 ****************************************************************************/
 
+#include <limits.h>
+#include <time.h>
 #include "barrier.h"
+#include "futex.h"
+
+#define CLOCK_CHECK_INTERVAL 64   // Spin iterations between looks at the clock.
 
 void barrier_init( barrier_t *b, int limit )
 {
-    pthread_mutex_init( &b->lock, NULL );
-    pthread_cond_init( &b->not_enough, NULL );
-    pthread_cond_init( &b->all_released, NULL );
     if( limit < 1 ) limit = 1;
-    b->max         = limit;
-    b->count       = 0;
-    b->releasing   = 0;
-    b->wait_needed = 0;
+    b->max       = limit;
+    b->spin_time = BARRIER_DEFAULT_SPIN;
+    atomic_init( &b->count, 0 );
+    atomic_init( &b->phase, 0 );
+    atomic_init( &b->sleepers, 0 );
 }
 
 void barrier_destroy( barrier_t *b )
 {
-    pthread_cond_destroy( &b->not_enough );
-    pthread_cond_destroy( &b->all_released );
-    pthread_mutex_destroy( &b->lock );
+    // Nothing to release.
+    (void)b;
 }
 
-void barrier_wait( barrier_t *b )
+void barrier_set_spin( barrier_t *b, long spin_time )
 {
-    pthread_mutex_lock( &b->lock );
+    b->spin_time = ( spin_time < 0 ) ? 0 : spin_time;
+}
 
-    // If the previous batch of threads is releasing, wait until they are all released.
-    while( b->releasing ) pthread_cond_wait( &b->all_released, &b->lock );
+// Nanoseconds from start to now.
+static long elapsed( const struct timespec *start )
+{
+    struct timespec now;
 
-    // One more thread on the barrier.
-    ++b->count;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return ( now.tv_sec - start->tv_sec ) * 1000000000L + ( now.tv_nsec - start->tv_nsec );
+}
 
-    // If we've reached the limit, start the releasing process.
-    if( b->count == b->max ) {
-        b->releasing   = 1;
-        b->wait_needed = 0;
-        pthread_cond_broadcast( &b->not_enough );
-        --b->count;
+int barrier_wait( barrier_t *b )
+{
+    struct timespec start;
+    unsigned        local_sense = atomic_load_explicit( &b->phase, memory_order_acquire );
+    unsigned        i;
+
+    // The last thread to arrive releases the others.
+    if( atomic_fetch_add_explicit( &b->count, 1, memory_order_acq_rel ) + 1 == b->max ) {
+        atomic_store_explicit( &b->count, 0, memory_order_relaxed );
+        atomic_store( &b->phase, local_sense + 1 );
+        if( atomic_load( &b->sleepers ) != 0 ) futex_wake( &b->phase, INT_MAX );
+        return BARRIER_SERIAL_THREAD;
     }
-    else {
-        // We are not at the limit; we need to wait.
-        b->wait_needed = 1;
-        while( b->wait_needed ) pthread_cond_wait( &b->not_enough, &b->lock );
-        --b->count;
-
-        // If we are the last thread out, turn off the releasing process and let others in.
-        if( b->count == 0 ) {
-            b->releasing = 0;
-            pthread_cond_broadcast( &b->all_released );
+
+    // Spin for a while in the hope that the others show up soon.
+    if( b->spin_time > 0 ) {
+        clock_gettime( CLOCK_MONOTONIC, &start );
+        for( i = 1; ; ++i ) {
+            if( atomic_load_explicit( &b->phase, memory_order_acquire ) != local_sense ) return 0;
+            if( i % CLOCK_CHECK_INTERVAL == 0 && elapsed( &start ) >= b->spin_time ) break;
         }
     }
-    pthread_mutex_unlock( &b->lock );
+
+    // Go to sleep. Registering as a sleeper before the final check of the phase means either the
+    // last thread sees us or we see the new phase (futex_wait also rechecks it atomically).
+    //
+    while( atomic_load_explicit( &b->phase, memory_order_acquire ) == local_sense ) {
+        atomic_fetch_add( &b->sleepers, 1 );
+        if( atomic_load( &b->phase ) == local_sense )
+            futex_wait( &b->phase, local_sense, NULL );
+        atomic_fetch_sub( &b->sleepers, 1 );
+    }
+    return 0;
 }
@@ -3,25 +3,47 @@ FILE          : barrier.h
 SUBJECT       : Interface to the barrier abstract data type.
 PROGRAMMER    : (C) Copyright 2010 by Peter C. Chapin <pcc482719@gmail.com>
 
+This is a sense reversing barrier. Each thread notes the barrier's current
+phase (its local "sense") when it arrives and then waits for the phase to
+change. The last thread to arrive resets the arrival counter and advances
+the phase, which releases everyone. Because the counter is reset before the
+phase changes, threads can start arriving for the next round at once; they
+never wait for stragglers from the previous round to leave.
+
+Waiting threads spin for a while (see barrier_set_spin) before going to
+sleep on a futex. The last thread only makes a system call if somebody is
+actually asleep.
 ****************************************************************************/
 
 #ifndef BARRIER_H
 #define BARRIER_H
 
-#include <pthread.h>
+#include <stdatomic.h>
+#include "cache_line.h"
+
+// Returned by barrier_wait in exactly one thread per phase, like PTHREAD_BARRIER_SERIAL_THREAD.
+#define BARRIER_SERIAL_THREAD (-1)
+
+// How long a thread spins before sleeping, by default. In nanoseconds.
+#define BARRIER_DEFAULT_SPIN 20000L
 
 typedef struct {
-    pthread_mutex_t lock;
-    pthread_cond_t  all_released;
-    pthread_cond_t  not_enough;
-    int max;
-    int count;
-    int releasing;
-    int wait_needed;
+    // Fixed after initialization.
+    unsigned max;
+    long     spin_time;
+
+    _Alignas(CACHE_LINE_SIZE) atomic_uint count;     // Arrivals in the current phase.
+    _Alignas(CACHE_LINE_SIZE) atomic_uint phase;     // Advanced when everyone has arrived.
+    atomic_uint sleepers;                            // Threads asleep on phase.
 } barrier_t;
 
 void barrier_init( barrier_t *b, int limit );
 void barrier_destroy( barrier_t *b );
-void barrier_wait( barrier_t *b );
+
+// Set how many nanoseconds a waiting thread spins before sleeping. Zero means sleep right away.
+void barrier_set_spin( barrier_t *b, long spin_time );
+
+// Returns BARRIER_SERIAL_THREAD in the last thread to arrive and zero in the others.
+int  barrier_wait( barrier_t *b );
 
 #endif
@@ -0,0 +1,145 @@
+/****************************************************************************
+FILE          : barrier_bench.c
+SUBJECT       : Compare the cost of the various barrier implementations.
+PROGRAMMER    : (C) Copyright 2026 by Peter C. Chapin <pcc482719@gmail.com>
+
+For thread counts 2, 4, 8, ... up to a maximum (128 by default) this
+program makes every thread pass through a barrier many times and reports
+the average time per barrier episode. It measures pthread_barrier_t (as
+used in posix-barrier-demo.c), barrier_t, tree_barrier_t and
+dissemination_barrier_t.
+
+Usage: barrier_bench [max_threads [episodes]]
+
+The spinning barriers only make sense when there is a core for each
+thread. Results for thread counts beyond the number of cores mostly
+measure the scheduler.
+
+Build with:
+  gcc -O2 -pthread -o barrier_bench barrier_bench.c barrier.c \
+      tree_barrier.c dissemination_barrier.c
+****************************************************************************/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "barrier.h"
+#include "tree_barrier.h"
+#include "dissemination_barrier.h"
+
+typedef enum { POSIX, CENTRAL, TREE, DISSEMINATION, KIND_COUNT } barrier_kind;
+
+static const char *kind_names[KIND_COUNT] = {
+    "pthread_barrier_t", "barrier_t", "tree_barrier_t", "dissemination_barrier_t"
+};
+
+// Everything the threads of one measurement need.
+static barrier_kind            kind;
+static int                     thread_count;
+static int                     episodes;
+static pthread_barrier_t       posix_barrier;
+static barrier_t               central_barrier;
+static tree_barrier_t          tree_barrier;
+static dissemination_barrier_t dissemination_barrier;
+static pthread_barrier_t       start_barrier;   // Lines everybody up before timing.
+static struct timespec         start_time;
+static struct timespec         stop_time;
+
+
+static void pass( int id )
+{
+    switch( kind ) {
+    case POSIX:         pthread_barrier_wait( &posix_barrier ); break;
+    case CENTRAL:       barrier_wait( &central_barrier ); break;
+    case TREE:          tree_barrier_wait( &tree_barrier, id ); break;
+    case DISSEMINATION: dissemination_barrier_wait( &dissemination_barrier, id ); break;
+    default:            break;
+    }
+}
+
+
+static void *thread_function( void *arg )
+{
+    int id = (int)(long)arg;
+    int i;
+
+    pthread_barrier_wait( &start_barrier );
+    if( id == 0 ) clock_gettime( CLOCK_MONOTONIC, &start_time );
+    for( i = 0; i < episodes; ++i ) {
+        pass( id );
+    }
+
+    // When thread 0 leaves the last episode every thread has arrived at it.
+    if( id == 0 ) clock_gettime( CLOCK_MONOTONIC, &stop_time );
+    return NULL;
+}
+
+
+// Returns the average number of nanoseconds per episode.
+static double measure( void )
+{
+    pthread_t *IDs = malloc( thread_count * sizeof( pthread_t ) );
+    long       i;
+    double     total;
+
+    pthread_barrier_init( &start_barrier, NULL, thread_count );
+    switch( kind ) {
+    case POSIX:         pthread_barrier_init( &posix_barrier, NULL, thread_count ); break;
+    case CENTRAL:       barrier_init( &central_barrier, thread_count ); break;
+    case TREE:          tree_barrier_init( &tree_barrier, thread_count ); break;
+    case DISSEMINATION: dissemination_barrier_init( &dissemination_barrier, thread_count ); break;
+    default:            break;
+    }
+
+    for( i = 0; i < thread_count; ++i ) {
+        pthread_create( &IDs[i], NULL, thread_function, (void *)i );
+    }
+    for( i = 0; i < thread_count; ++i ) {
+        pthread_join( IDs[i], NULL );
+    }
+
+    switch( kind ) {
+    case POSIX:         pthread_barrier_destroy( &posix_barrier ); break;
+    case CENTRAL:       barrier_destroy( &central_barrier ); break;
+    case TREE:          tree_barrier_destroy( &tree_barrier ); break;
+    case DISSEMINATION: dissemination_barrier_destroy( &dissemination_barrier ); break;
+    default:            break;
+    }
+    pthread_barrier_destroy( &start_barrier );
+    free( IDs );
+
+    total = ( stop_time.tv_sec - start_time.tv_sec ) * 1e9 + ( stop_time.tv_nsec - start_time.tv_nsec );
+    return total / episodes;
+}
+
+
+int main( int argc, char **argv )
+{
+    int max_threads = 128;
+
+    episodes = 10000;
+    if( argc > 1 ) max_threads = atoi( argv[1] );
+    if( argc > 2 ) episodes    = atoi( argv[2] );
+    if( max_threads < 2 || episodes < 1 ) {
+        fprintf( stderr, "Usage: %s [max_threads [episodes]]\n", argv[0] );
+        return EXIT_FAILURE;
+    }
+
+    printf( "%7s", "threads" );
+    for( kind = 0; kind < KIND_COUNT; ++kind ) printf( " %24s", kind_names[kind] );
+    printf( "\n" );
+
+    for( thread_count = 2; thread_count <= max_threads; thread_count *= 2 ) {
+        printf( "%7d", thread_count );
+        for( kind = 0; kind < KIND_COUNT; ++kind ) {
+            printf( " %21.0f ns", measure( ) );
+            fflush( stdout );
+        }
+        printf( "\n" );
+    }
+    return EXIT_SUCCESS;
+}
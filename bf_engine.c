@@ -0,0 +1,245 @@
+/****************************************************************************
+FILE    : bf_engine.c
+SUBJECT : Implementation of a multi-block Blowfish engine.
+AUTHOR  : (C) Copyright 2026 by Peter C. Chapin <pcc482719@gmail.com>
+
+The rounds follow OpenSSL's BF_encrypt exactly: the left half is xored
+with P[0], then sixteen rounds each xor one half with the next P entry and
+F of the other half, and finally the right half is xored with P[17] and
+the halves are swapped.
+****************************************************************************/
+
+#include <stdatomic.h>
+#include <string.h>
+#include "bf_engine.h"
+
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#define HAVE_AVX2_KERNEL 1
+#include <immintrin.h>
+#endif
+
+#define F( S, x ) ( ( ( ( S )[( x ) >> 24] + ( S )[0x100 + ( ( ( x ) >> 16 ) & 0xff )] ) ^ \
+                      ( S )[0x200 + ( ( ( x ) >> 8 ) & 0xff )] ) + ( S )[0x300 + ( ( x ) & 0xff )] )
+
+typedef void ( *kernel_fn )( const BF_KEY *key, unsigned char *blocks, size_t count );
+
+static BF_LONG load_be( const unsigned char *p )
+{
+    return ( (BF_LONG)p[0] << 24 ) | ( (BF_LONG)p[1] << 16 ) | ( (BF_LONG)p[2] << 8 ) | p[3];
+}
+
+
+static void store_be( unsigned char *p, BF_LONG x )
+{
+    p[0] = (unsigned char)( x >> 24 );
+    p[1] = (unsigned char)( x >> 16 );
+    p[2] = (unsigned char)( x >>  8 );
+    p[3] = (unsigned char)( x       );
+}
+
+
+// One block at a time, for whatever is left over.
+static void encrypt_one( const BF_KEY *key, unsigned char *block )
+{
+    const BF_LONG *P = key->P;
+    const BF_LONG *S = key->S;
+    BF_LONG l = load_be( block );
+    BF_LONG r = load_be( block + 4 );
+    int     i;
+
+    l ^= P[0];
+    for( i = 1; i <= 16; i += 2 ) {
+        r ^= P[i]     ^ F( S, l );
+        l ^= P[i + 1] ^ F( S, r );
+    }
+    r ^= P[17];
+    store_be( block, r );
+    store_be( block + 4, l );
+}
+
+
+// Four blocks with their rounds interleaved.
+static void portable_kernel( const BF_KEY *key, unsigned char *blocks, size_t count )
+{
+    const BF_LONG *P = key->P;
+    const BF_LONG *S = key->S;
+    BF_LONG l0, l1, l2, l3;
+    BF_LONG r0, r1, r2, r3;
+    int     i;
+
+    for( ; count >= 4; count -= 4, blocks += 32 ) {
+        l0 = load_be( blocks      ) ^ P[0];  r0 = load_be( blocks +  4 );
+        l1 = load_be( blocks +  8 ) ^ P[0];  r1 = load_be( blocks + 12 );
+        l2 = load_be( blocks + 16 ) ^ P[0];  r2 = load_be( blocks + 20 );
+        l3 = load_be( blocks + 24 ) ^ P[0];  r3 = load_be( blocks + 28 );
+        for( i = 1; i <= 16; i += 2 ) {
+            r0 ^= P[i] ^ F( S, l0 );
+            r1 ^= P[i] ^ F( S, l1 );
+            r2 ^= P[i] ^ F( S, l2 );
+            r3 ^= P[i] ^ F( S, l3 );
+            l0 ^= P[i + 1] ^ F( S, r0 );
+            l1 ^= P[i + 1] ^ F( S, r1 );
+            l2 ^= P[i + 1] ^ F( S, r2 );
+            l3 ^= P[i + 1] ^ F( S, r3 );
+        }
+        store_be( blocks,      r0 ^ P[17] );  store_be( blocks +  4, l0 );
+        store_be( blocks +  8, r1 ^ P[17] );  store_be( blocks + 12, l1 );
+        store_be( blocks + 16, r2 ^ P[17] );  store_be( blocks + 20, l2 );
+        store_be( blocks + 24, r3 ^ P[17] );  store_be( blocks + 28, l3 );
+    }
+    for( ; count > 0; --count, blocks += 8 ) encrypt_one( key, blocks );
+}
+
+
+#ifdef HAVE_AVX2_KERNEL
+
+// F for eight halves at once. Each S-box lookup is a gather.
+__attribute__(( target( "avx2" ) ))
+static inline __m256i avx2_f( const BF_LONG *S, __m256i x )
+{
+    const __m256i byte = _mm256_set1_epi32( 0xff );
+    __m256i a = _mm256_i32gather_epi32( (const int *)S, _mm256_srli_epi32( x, 24 ), 4 );
+    __m256i b = _mm256_i32gather_epi32( (const int *)( S + 0x100 ),
+                                        _mm256_and_si256( _mm256_srli_epi32( x, 16 ), byte ), 4 );
+    __m256i c = _mm256_i32gather_epi32( (const int *)( S + 0x200 ),
+                                        _mm256_and_si256( _mm256_srli_epi32( x, 8 ), byte ), 4 );
+    __m256i d = _mm256_i32gather_epi32( (const int *)( S + 0x300 ),
+                                        _mm256_and_si256( x, byte ), 4 );
+    return _mm256_add_epi32( _mm256_xor_si256( _mm256_add_epi32( a, b ), c ), d );
+}
+
+
+// Eight blocks, one per lane.
+__attribute__(( target( "avx2" ) ))
+static void avx2_kernel( const BF_KEY *key, unsigned char *blocks, size_t count )
+{
+    const BF_LONG *P = key->P;
+    const BF_LONG *S = key->S;
+    BF_LONG halves[2][8];
+    __m256i l;
+    __m256i r;
+    int     i;
+    int     j;
+
+    for( ; count >= 8; count -= 8, blocks += 64 ) {
+        for( j = 0; j < 8; ++j ) {
+            halves[0][j] = load_be( blocks + 8*j );
+            halves[1][j] = load_be( blocks + 8*j + 4 );
+        }
+        l = _mm256_loadu_si256( (const __m256i *)halves[0] );
+        r = _mm256_loadu_si256( (const __m256i *)halves[1] );
+        l = _mm256_xor_si256( l, _mm256_set1_epi32( P[0] ) );
+        for( i = 1; i <= 16; i += 2 ) {
+            r = _mm256_xor_si256( r, _mm256_xor_si256( _mm256_set1_epi32( P[i] ), avx2_f( S, l ) ) );
+            l = _mm256_xor_si256( l, _mm256_xor_si256( _mm256_set1_epi32( P[i + 1] ), avx2_f( S, r ) ) );
+        }
+        r = _mm256_xor_si256( r, _mm256_set1_epi32( P[17] ) );
+        _mm256_storeu_si256( (__m256i *)halves[0], r );
+        _mm256_storeu_si256( (__m256i *)halves[1], l );
+        for( j = 0; j < 8; ++j ) {
+            store_be( blocks + 8*j,     halves[0][j] );
+            store_be( blocks + 8*j + 4, halves[1][j] );
+        }
+    }
+    portable_kernel( key, blocks, count );
+}
+
+#endif
+
+
+// Threads that race to make the first choice all make the same one.
+static _Atomic kernel_fn kernel = NULL;
+
+static kernel_fn current_kernel( void )
+{
+    kernel_fn k = atomic_load_explicit( &kernel, memory_order_relaxed );
+
+    if( k == NULL ) {
+        bf_engine_select( BF_ENGINE_AUTO );
+        k = atomic_load_explicit( &kernel, memory_order_relaxed );
+    }
+    return k;
+}
+
+
+int bf_engine_select( bf_engine_kind kind )
+{
+#ifdef HAVE_AVX2_KERNEL
+    if( kind != BF_ENGINE_PORTABLE && __builtin_cpu_supports( "avx2" ) ) {
+        atomic_store_explicit( &kernel, avx2_kernel, memory_order_relaxed );
+        return 0;
+    }
+#endif
+    if( kind == BF_ENGINE_AVX2 ) return -1;
+    atomic_store_explicit( &kernel, portable_kernel, memory_order_relaxed );
+    return 0;
+}
+
+
+const char *bf_engine_name( void )
+{
+    return ( current_kernel( ) == portable_kernel ) ? "portable" : "avx2";
+}
+
+
+void bf_engine_encrypt( const BF_KEY *key, unsigned char *blocks, size_t count )
+{
+    current_kernel( )( key, blocks, count );
+}
+
+
+void bf_engine_cfb64_decrypt( const BF_KEY *key,
+                              const unsigned char *in,
+                              unsigned char *out,
+                              size_t length,
+                              unsigned char *ivec,
+                              int *num )
+{
+    unsigned char stream[BF_ENGINE_BATCH * 8];
+    unsigned char last[8];
+    size_t  blocks;
+    size_t  i;
+    int     n = *num;
+
+    // While n is nonzero ivec holds the ciphertext so far of the current block followed by the
+    // rest of its key stream. Finish that block first.
+    //
+    while( n != 0 && length > 0 ) {
+        unsigned char c = *in++;
+        *out++  = ivec[n] ^ c;
+        ivec[n] = c;
+        n = ( n + 1 ) & 7;
+        --length;
+    }
+
+    // The key stream for each whole block is the encryption of the ciphertext block before it.
+    // That is all known in advance, so the blocks can be done together. The ciphertext is
+    // copied before anything is written in case out is the same as in.
+    //
+    while( length >= 8 ) {
+        blocks = length / 8;
+        if( blocks > BF_ENGINE_BATCH ) blocks = BF_ENGINE_BATCH;
+        memcpy( stream, ivec, 8 );
+        memcpy( stream + 8, in, ( blocks - 1 ) * 8 );
+        memcpy( last, in + ( blocks - 1 ) * 8, 8 );
+        bf_engine_encrypt( key, stream, blocks );
+        for( i = 0; i < blocks * 8; ++i ) out[i] = in[i] ^ stream[i];
+        memcpy( ivec, last, 8 );
+        in     += blocks * 8;
+        out    += blocks * 8;
+        length -= blocks * 8;
+    }
+
+    // Start a partial block as BF_cfb64_encrypt would.
+    if( length > 0 ) {
+        bf_engine_encrypt( key, ivec, 1 );
+        while( length > 0 ) {
+            unsigned char c = *in++;
+            *out++  = ivec[n] ^ c;
+            ivec[n] = c;
+            ++n;
+            --length;
+        }
+    }
+    *num = n;
+}
@@ -0,0 +1,48 @@
+/****************************************************************************
+FILE    : bf_engine.h
+SUBJECT : Interface to a multi-block Blowfish engine.
+AUTHOR  : (C) Copyright 2026 by Peter C. Chapin <pcc482719@gmail.com>
+
+BF_encrypt works on one 8 byte block at a time. Each of its 16 rounds
+needs the result of the one before, so most of the processor's execution
+units sit idle waiting for S-box loads. When blocks are independent, as
+in counter mode or CFB decryption, several can be encrypted together with
+their rounds interleaved so the loads overlap. This engine does that with
+the key schedule OpenSSL's BF_set_key builds, and the results are bit for
+bit those of OpenSSL.
+
+There are two kernels. The portable one interleaves four blocks in
+ordinary C. On x86 processors with AVX2 the other does eight blocks at
+once, one per vector lane, with gather instructions for the S-box
+lookups. The best kernel the processor supports is chosen at run time.
+****************************************************************************/
+
+#ifndef BF_ENGINE_H
+#define BF_ENGINE_H
+
+#include <stddef.h>
+#include <openssl/blowfish.h>
+
+#define BF_ENGINE_BATCH 64  // Blocks the mode functions encrypt per engine call.
+
+typedef enum { BF_ENGINE_AUTO, BF_ENGINE_PORTABLE, BF_ENGINE_AVX2 } bf_engine_kind;
+
+// Choose the kernel. Meant for benchmarks and tests; call it before any threads use the engine.
+// Returns 0 or -1 if this processor (or build) can't run that kernel.
+int  bf_engine_select( bf_engine_kind kind );
+
+// The name of the kernel in use.
+const char *bf_engine_name( void );
+
+// Encrypt count 8 byte blocks in place (ECB), each as BF_encrypt would with big endian halves.
+void bf_engine_encrypt( const BF_KEY *key, unsigned char *blocks, size_t count );
+
+// A replacement for BF_cfb64_encrypt( ..., BF_DECRYPT ) with the same arguments and results.
+void bf_engine_cfb64_decrypt( const BF_KEY *key,
+                              const unsigned char *in,
+                              unsigned char *out,
+                              size_t length,
+                              unsigned char *ivec,
+                              int *num );
+
+#endif
@@ -0,0 +1,255 @@
+/****************************************************************************
+FILE          : bf_engine_bench.c
+SUBJECT       : Check the multi-block Blowfish engine and measure its speed.
+PROGRAMMER    : (C) Copyright 2026 by Peter C. Chapin <pcc482719@gmail.com>
+
+First the program checks every kernel the processor can run against
+OpenSSL, using random keys and data: single blocks against BF_encrypt,
+CFB decryption against BF_cfb64_encrypt (fed in pieces of random length
+so partial blocks are covered), and counter mode against a key stream
+built one block at a time with BF_encrypt.
+
+Then it reports the throughput of one thread, in MB/s, for CFB decryption
+and raw block encryption: OpenSSL's functions first, as bfish used them,
+then each kernel of the engine.
+
+Usage: bf_engine_bench [megabytes [passes]]
+
+Build with:
+  gcc -O2 -o bf_engine_bench bf_engine_bench.c bf_engine.c bfctr.c -lcrypto
+****************************************************************************/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <openssl/blowfish.h>
+
+#include "bf_engine.h"
+#include "bfctr.h"
+
+#define KEY_TRIALS  20
+#define CHECK_BYTES 10007   // Not a multiple of the block size.
+
+static const bf_engine_kind kinds[] = { BF_ENGINE_PORTABLE, BF_ENGINE_AVX2 };
+#define KIND_COUNT ( sizeof( kinds ) / sizeof( kinds[0] ) )
+
+
+static double now( void )
+{
+    struct timespec t;
+
+    clock_gettime( CLOCK_MONOTONIC, &t );
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+
+static void random_bytes( unsigned char *p, size_t count )
+{
+    while( count-- > 0 ) *p++ = (unsigned char)( rand( ) >> 7 );
+}
+
+
+static void random_key( BF_KEY *key )
+{
+    unsigned char raw[16];
+
+    random_bytes( raw, 16 );
+    BF_set_key( key, 16, raw );
+}
+
+
+// The engine's blocks against BF_encrypt, one at a time.
+static int check_blocks( const BF_KEY *key, const unsigned char *data, size_t count )
+{
+    unsigned char *mine = malloc( count * 8 );
+    BF_LONG        block[2];
+    size_t         i;
+    int            j;
+    int            errors = 0;
+
+    memcpy( mine, data, count * 8 );
+    bf_engine_encrypt( key, mine, count );
+    for( i = 0; i < count; ++i ) {
+        block[0] = block[1] = 0;
+        for( j = 0; j < 4; ++j ) {
+            block[0] = ( block[0] << 8 ) | data[8*i + j];
+            block[1] = ( block[1] << 8 ) | data[8*i + 4 + j];
+        }
+        BF_encrypt( block, key );
+        for( j = 0; j < 4; ++j ) {
+            if( mine[8*i + j]     != (unsigned char)( block[0] >> ( 24 - 8*j ) ) ||
+                mine[8*i + 4 + j] != (unsigned char)( block[1] >> ( 24 - 8*j ) ) ) {
+                ++errors;
+                break;
+            }
+        }
+    }
+    free( mine );
+    return errors;
+}
+
+
+// CFB decryption in pieces of random length, each kept going from where the last left off.
+static int check_cfb( const BF_KEY *key, const unsigned char *data, size_t count )
+{
+    unsigned char *expected = malloc( count );
+    unsigned char *mine     = malloc( count );
+    unsigned char  iv1[8] = { 0 };
+    unsigned char  iv2[8] = { 0 };
+    int            num1 = 0;
+    int            num2 = 0;
+    size_t         done = 0;
+    size_t         piece;
+    int            errors;
+
+    BF_cfb64_encrypt( data, expected, count, key, iv1, &num1, BF_DECRYPT );
+    memcpy( mine, data, count );
+    while( done < count ) {
+        piece = rand( ) % 1000;
+        if( piece > count - done ) piece = count - done;
+        bf_engine_cfb64_decrypt( key, mine + done, mine + done, piece, iv2, &num2 );
+        done += piece;
+    }
+    errors = ( memcmp( expected, mine, count ) != 0 || memcmp( iv1, iv2, 8 ) != 0 || num1 != num2 );
+    free( expected );
+    free( mine );
+    return errors;
+}
+
+
+// Counter mode starting at an odd offset against a key stream made one block at a time.
+static int check_counter( const BF_KEY *key, const unsigned char *data, size_t count )
+{
+    unsigned char  nonce[8];
+    unsigned char *mine = malloc( count );
+    unsigned long long counter = 0;
+    unsigned long long offset  = rand( ) % 100000;
+    BF_LONG        block[2];
+    size_t         i;
+    int            j;
+    int            errors = 0;
+
+    random_bytes( nonce, 8 );
+    for( j = 0; j < 8; ++j ) counter = ( counter << 8 ) | nonce[j];
+    bfctr_crypt( key, nonce, offset, data, mine, count );
+    for( i = 0; i < count; ++i ) {
+        unsigned long long n = counter + ( offset + i ) / 8;
+        int                k = ( offset + i ) % 8;
+
+        block[0] = (BF_LONG)( n >> 32 );
+        block[1] = (BF_LONG)( n & 0xFFFFFFFFUL );
+        BF_encrypt( block, key );
+        if( ( mine[i] ^ data[i] ) != (unsigned char)( block[k / 4] >> ( 24 - 8 * ( k % 4 ) ) ) ) {
+            ++errors;
+            break;
+        }
+    }
+    free( mine );
+    return errors;
+}
+
+
+static void report( const char *name, size_t bytes, int passes, double elapsed )
+{
+    printf( "%-28s %9.1f MB/s\n", name, (double)bytes * passes / elapsed / 1e6 );
+}
+
+
+int main( int argc, char **argv )
+{
+    BF_KEY         key;
+    unsigned char *data;
+    unsigned char *out;
+    unsigned char  iv[8];
+    char           name[64];
+    size_t         bytes  = 16L * 1024 * 1024;
+    int            passes = 4;
+    int            num;
+    int            trial;
+    int            errors = 0;
+    unsigned       k;
+    int            p;
+    size_t         i;
+    BF_LONG        block[2];
+    double         start;
+
+    if( argc > 1 ) bytes  = (size_t)atol( argv[1] ) * 1024 * 1024;
+    if( argc > 2 ) passes = atoi( argv[2] );
+    if( bytes == 0 || passes < 1 ) {
+        fprintf( stderr, "Usage: %s [megabytes [passes]]\n", argv[0] );
+        return EXIT_FAILURE;
+    }
+    data = malloc( bytes );
+    out  = malloc( bytes );
+    if( data == NULL || out == NULL ) {
+        fprintf( stderr, "Unable to allocate %zu bytes\n", bytes );
+        return EXIT_FAILURE;
+    }
+    srand( 42 );
+    random_bytes( data, bytes );
+
+    // Correctness.
+    for( k = 0; k < KIND_COUNT; ++k ) {
+        int failures = 0;
+
+        if( bf_engine_select( kinds[k] ) == -1 ) continue;
+        for( trial = 0; trial < KEY_TRIALS; ++trial ) {
+            random_key( &key );
+            failures += check_blocks( &key, data, 1 + rand( ) % 100 );
+            failures += check_cfb( &key, data, CHECK_BYTES );
+            failures += check_counter( &key, data, CHECK_BYTES );
+        }
+        printf( "%-28s %s\n", bf_engine_name( ), ( failures == 0 ) ? "matches OpenSSL" : "WRONG" );
+        errors += failures;
+    }
+
+    // Speed.
+    random_key( &key );
+    printf( "\n%zu MB, %d passes, one thread\n", bytes / ( 1024 * 1024 ), passes );
+
+    start = now( );
+    for( p = 0; p < passes; ++p ) {
+        memset( iv, 0, 8 );
+        num = 0;
+        BF_cfb64_encrypt( data, out, bytes, &key, iv, &num, BF_DECRYPT );
+    }
+    report( "OpenSSL CFB decrypt", bytes, passes, now( ) - start );
+
+    start = now( );
+    for( p = 0; p < passes; ++p ) {
+        for( i = 0; i + 8 <= bytes; i += 8 ) {
+            memcpy( block, data + i, 8 );
+            BF_encrypt( block, &key );
+            memcpy( out + i, block, 8 );
+        }
+    }
+    report( "OpenSSL BF_encrypt", bytes, passes, now( ) - start );
+
+    for( k = 0; k < KIND_COUNT; ++k ) {
+        if( bf_engine_select( kinds[k] ) == -1 ) continue;
+
+        start = now( );
+        for( p = 0; p < passes; ++p ) {
+            memset( iv, 0, 8 );
+            num = 0;
+            bf_engine_cfb64_decrypt( &key, data, out, bytes, iv, &num );
+        }
+        sprintf( name, "engine CFB decrypt (%s)", bf_engine_name( ) );
+        report( name, bytes, passes, now( ) - start );
+
+        start = now( );
+        for( p = 0; p < passes; ++p ) {
+            memcpy( out, data, bytes );
+            bf_engine_encrypt( &key, out, bytes / 8 );
+        }
+        sprintf( name, "engine blocks (%s)", bf_engine_name( ) );
+        report( name, bytes, passes, now( ) - start );
+    }
+
+    free( data );
+    free( out );
+    return ( errors == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
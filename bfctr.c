@@ -0,0 +1,107 @@
+/****************************************************************************
+FILE    : bfctr.c
+SUBJECT : Implementation of the Blowfish counter mode container format.
+AUTHOR  : (C) Copyright 2026 by Peter C. Chapin <pcc482719@gmail.com>
+
+****************************************************************************/
+
+#include <string.h>
+#include <unistd.h>
+#include <openssl/rand.h>
+#include "bf_engine.h"
+#include "bfctr.h"
+
+static const unsigned char magic[4] = { 'B', 'F', 'c', 't' };
+
+int bfctr_new_header( bfctr_header_t *h, unsigned long chunk_size )
+{
+    h->mode       = BFCTR_MODE_CTR;
+    h->chunk_size = chunk_size;
+    if( RAND_bytes( h->nonce, 8 ) != 1 ) return -1;
+    return 0;
+}
+
+
+int bfctr_write_header( int fd, const bfctr_header_t *h )
+{
+    unsigned char raw[BFCTR_HEADER_SIZE];
+
+    memset( raw, 0, BFCTR_HEADER_SIZE );
+    memcpy( raw, magic, 4 );
+    raw[4] = BFCTR_VERSION;
+    raw[5] = (unsigned char)h->mode;
+    memcpy( raw + 8, h->nonce, 8 );
+    raw[16] = (unsigned char)( h->chunk_size >> 24 );
+    raw[17] = (unsigned char)( h->chunk_size >> 16 );
+    raw[18] = (unsigned char)( h->chunk_size >>  8 );
+    raw[19] = (unsigned char)( h->chunk_size       );
+
+    if( write( fd, raw, BFCTR_HEADER_SIZE ) != BFCTR_HEADER_SIZE ) return -1;
+    return 0;
+}
+
+
+int bfctr_read_header( int fd, bfctr_header_t *h )
+{
+    unsigned char raw[BFCTR_HEADER_SIZE];
+    size_t  total = 0;
+    ssize_t count;
+
+    // The input might be a pipe, so be ready for short reads.
+    while( total < BFCTR_HEADER_SIZE ) {
+        count = read( fd, raw + total, BFCTR_HEADER_SIZE - total );
+        if( count <= 0 ) return -1;
+        total += count;
+    }
+
+    if( memcmp( raw, magic, 4 ) != 0 ) return -1;
+    if( raw[4] != BFCTR_VERSION || raw[5] != BFCTR_MODE_CTR ) return -1;
+
+    h->mode = raw[5];
+    memcpy( h->nonce, raw + 8, 8 );
+    h->chunk_size = ( (unsigned long)raw[16] << 24 ) |
+                    ( (unsigned long)raw[17] << 16 ) |
+                    ( (unsigned long)raw[18] <<  8 ) |
+                    ( (unsigned long)raw[19]       );
+    return 0;
+}
+
+
+void bfctr_crypt( const BF_KEY *key,
+                  const unsigned char *nonce,
+                  unsigned long long offset,
+                  const unsigned char *in,
+                  unsigned char *out,
+                  size_t count )
+{
+    unsigned long long base = 0;
+    unsigned long long counter;
+    unsigned char stream[BF_ENGINE_BATCH * 8];
+    size_t  blocks;
+    size_t  used;
+    size_t  i;
+    int     j;
+    int     position = offset % 8;
+
+    for( j = 0; j < 8; ++j ) base = ( base << 8 ) | nonce[j];
+    counter = base + offset / 8;
+
+    // The counter blocks don't depend on each other, so the engine does a batch at a time.
+    while( count > 0 ) {
+        blocks = ( position + count + 7 ) / 8;
+        if( blocks > BF_ENGINE_BATCH ) blocks = BF_ENGINE_BATCH;
+        for( i = 0; i < blocks; ++i, ++counter ) {
+            for( j = 0; j < 8; ++j ) stream[8*i + j] = (unsigned char)( counter >> ( 56 - 8*j ) );
+        }
+        bf_engine_encrypt( key, stream, blocks );
+
+        // The first block may be partly used up already, and the last may not be needed in full.
+        used = blocks * 8 - position;
+        if( used > count ) used = count;
+        for( i = 0; i < used; ++i ) out[i] = in[i] ^ stream[position + i];
+        in       += used;
+        out      += used;
+        count    -= used;
+        position  = 0;
+    }
+}
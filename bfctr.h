@@ -0,0 +1,55 @@
+/****************************************************************************
+FILE    : bfctr.h
+SUBJECT : Interface to the Blowfish counter mode container format.
+AUTHOR  : (C) Copyright 2026 by Peter C. Chapin <pcc482719@gmail.com>
+
+Files written in counter mode start with a small header followed by the
+ciphertext. Every byte of the file is encrypted with a key stream block
+that depends only on the nonce and the byte's offset, so any part of the
+file can be encrypted or decrypted without looking at any other part.
+
+The header is BFCTR_HEADER_SIZE bytes:
+
+    0 - 3   Magic number "BFct"
+    4       Format version (1)
+    5       Mode (BFCTR_MODE_CTR)
+    6 - 7   Reserved (zero)
+    8 - 15  Nonce
+   16 - 19  Chunk size used by the writer (big endian, informational)
+
+The key stream block for byte offset N is the encryption of the nonce,
+taken as a big endian 64 bit number, plus N/8.
+****************************************************************************/
+
+#ifndef BFCTR_H
+#define BFCTR_H
+
+#include <stddef.h>
+#include <openssl/blowfish.h>
+
+#define BFCTR_HEADER_SIZE 20
+#define BFCTR_VERSION     1
+#define BFCTR_MODE_CTR    1
+
+typedef struct {
+    int           mode;
+    unsigned char nonce[8];
+    unsigned long chunk_size;
+} bfctr_header_t;
+
+// Fill in a header with a fresh random nonce. Returns 0 or -1 if no random data is available.
+int  bfctr_new_header( bfctr_header_t *h, unsigned long chunk_size );
+
+// Read or write the header at the current file position. Both return 0 or -1 on error.
+int  bfctr_write_header( int fd, const bfctr_header_t *h );
+int  bfctr_read_header( int fd, bfctr_header_t *h );
+
+// Encrypt or decrypt (the same operation) count bytes found at the given offset in the stream.
+void bfctr_crypt( const BF_KEY *key,
+                  const unsigned char *nonce,
+                  unsigned long long offset,
+                  const unsigned char *in,
+                  unsigned char *out,
+                  size_t count );
+
+#endif
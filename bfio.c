@@ -0,0 +1,111 @@
+/****************************************************************************
+FILE    : bfio.c
+SUBJECT : Implementation of I/O helpers shared by bfish and bfishmt.
+AUTHOR  : (C) Copyright 2026 by Peter C. Chapin <pcc482719@gmail.com>
+
+****************************************************************************/
+
+#define _GNU_SOURCE  // For F_SETPIPE_SZ.
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "bfio.h"
+
+long bfio_parse_size( const char *text )
+{
+    char *end;
+    long  size;
+    long  multiplier = 1;
+
+    if( strcmp( text, "auto" ) == 0 ) return BFIO_AUTO;
+    size = strtol( text, &end, 10 );
+    if( end == text ) return -1;
+    switch( *end ) {
+    case 'k': case 'K': multiplier = 1024L;        end++; break;
+    case 'm': case 'M': multiplier = 1024L * 1024; end++; break;
+    default: break;
+    }
+
+    // Check the range before multiplying so a huge count can't overflow. strtol gives LONG_MAX
+    // for a number too big for a long, which fails here too.
+    if( *end != '\0' || size < 0 || size > BFIO_MAX_SIZE / multiplier ) return -1;
+    size *= multiplier;
+    return ( size < BFIO_MIN_SIZE ) ? -1 : size;
+}
+
+
+long bfio_auto_size( int fd )
+{
+    struct stat info;
+    long        size = BFIO_MIN_SIZE;
+
+    if( fstat( fd, &info ) == -1 ) return BFIO_DEFAULT_SIZE;
+    if( !S_ISREG( info.st_mode ) ) return BFIO_PIPE_SIZE;
+
+    while( size < info.st_blksize && size < BFIO_MAX_SIZE ) size *= 2;
+    while( size < BFIO_AUTO_LIMIT && size * 2 * BFIO_AUTO_CHUNKS <= info.st_size ) size *= 2;
+    return size;
+}
+
+
+size_t bfio_alignment( int fd )
+{
+    struct stat info;
+    size_t      alignment = (size_t)sysconf( _SC_PAGESIZE );
+
+    // Only a power of two will do for aligned_alloc.
+    if( fstat( fd, &info ) == 0 && (size_t)info.st_blksize > alignment &&
+        ( info.st_blksize & ( info.st_blksize - 1 ) ) == 0 ) alignment = info.st_blksize;
+    return alignment;
+}
+
+
+void *bfio_alloc( size_t size, size_t alignment )
+{
+    return aligned_alloc( alignment, ( size + alignment - 1 ) / alignment * alignment );
+}
+
+
+int bfio_write_all( int fd, const void *buffer, size_t count )
+{
+    const char *p = buffer;
+    ssize_t     written;
+
+    while( count > 0 ) {
+        if( ( written = write( fd, p, count ) ) == -1 ) return -1;
+        p     += written;
+        count -= written;
+    }
+    return 0;
+}
+
+
+ssize_t bfio_read_full( int fd, void *buffer, size_t count )
+{
+    char   *p = buffer;
+    ssize_t got;
+
+    while( count > 0 ) {
+        if( ( got = read( fd, p, count ) ) == -1 ) return -1;
+        if( got == 0 ) break;
+        p     += got;
+        count -= got;
+    }
+    return p - (char *)buffer;
+}
+
+
+void bfio_grow_pipe( int fd, long size )
+{
+#ifdef F_SETPIPE_SZ
+    struct stat info;
+
+    if( fstat( fd, &info ) == 0 && S_ISFIFO( info.st_mode ) &&
+        fcntl( fd, F_GETPIPE_SZ ) < size ) {
+        fcntl( fd, F_SETPIPE_SZ, size );  // Just a hint; the default size still works.
+    }
+#endif
+}
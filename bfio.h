@@ -0,0 +1,55 @@
+/****************************************************************************
+FILE    : bfio.h
+SUBJECT : Interface to I/O helpers shared by bfish and bfishmt.
+AUTHOR  : (C) Copyright 2026 by Peter C. Chapin <pcc482719@gmail.com>
+
+Both programs move the file in chunks. Small chunks mean a read and a write
+system call (and, in bfishmt, two trips through the pipeline's buffers)
+for every few kilobytes, which dominates on fast storage. These functions
+let the chunk size be chosen on the command line, either explicitly or
+automatically from the file, and allocate buffers aligned for the file.
+****************************************************************************/
+
+#ifndef BFIO_H
+#define BFIO_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#define BFIO_DEFAULT_SIZE  4096L
+#define BFIO_MIN_SIZE      4096L
+#define BFIO_MAX_SIZE      ( 16L * 1024 * 1024 )
+#define BFIO_AUTO          0L
+
+#define BFIO_AUTO_CHUNKS   64L               // Auto mode leaves at least this many chunks ...
+#define BFIO_AUTO_LIMIT    ( 1024L * 1024 )  // ... and doesn't go past this size.
+#define BFIO_PIPE_SIZE     ( 64L * 1024 )    // Auto mode's choice for pipes and the like.
+
+// Parse a chunk size such as 65536, 64K or 4M, or the word "auto". Returns the size, BFIO_AUTO,
+// or -1 if the text is not a size between BFIO_MIN_SIZE and BFIO_MAX_SIZE.
+long   bfio_parse_size( const char *text );
+
+// Choose a chunk size for reading fd. It is a power of two no smaller than the file's preferred
+// I/O block size, grown with the file size up to BFIO_AUTO_LIMIT.
+long   bfio_auto_size( int fd );
+
+// The larger of the page size and fd's preferred I/O block size.
+size_t bfio_alignment( int fd );
+
+// Allocate size bytes (rounded up to a multiple of alignment) on an alignment boundary. Returns
+// NULL if memory runs out.
+void  *bfio_alloc( size_t size, size_t alignment );
+
+// Write all count bytes, coping with partial writes. Returns 0 or -1 with errno set.
+int    bfio_write_all( int fd, const void *buffer, size_t count );
+
+// Read count bytes, or as many as there are before the end of the input. A pipe hands over
+// whatever its writer has produced so far, so a single read can come up short long before the
+// end. Returns the number of bytes read or -1 with errno set.
+ssize_t bfio_read_full( int fd, void *buffer, size_t count );
+
+// If fd is a pipe, try to make its buffer hold at least size bytes (Linux only, and limited by
+// /proc/sys/fs/pipe-max-size) so the program on the other end can run further ahead.
+void   bfio_grow_pipe( int fd, long size );
+
+#endif
@@ -22,13 +22,11 @@ if [ -f afile.txt -o -f afile.enc -o -f afile.out ]; then
   rm -f afile.txt afile.enc afile.out
 fi
 
-# Should search the path for makebig. Maybe later
-
-# Perform tests.
+# Perform tests on files of random data.
 ERROR=0
-for SIZE in 2048 4096 6144 8192 10250; do
+for SIZE in 2048 4096 6144 8192 10250 300000; do
   echo "Size = $SIZE"
-  makebig -b$SIZE > afile.txt 2> /dev/null
+  head -c $SIZE /dev/urandom > afile.txt
 
   echo "bfish..."
   bfish -e afile.txt afile.enc "Hello, World"
@@ -54,6 +52,14 @@ for SIZE in 2048 4096 6144 8192 10250; do
     ERROR=1
   fi
 
+  echo "bfish to bfishmt with 4 decryptors..."
+  bfish -e afile.txt afile.enc "Hello, World"
+  bfishmt -d -j 4 afile.enc afile.out "Hello, World"
+  cmp afile.txt afile.out
+  if [ $? -ne 0 ]; then
+    ERROR=1
+  fi
+
   echo "bfishmt to bfish..."
   bfishmt -e afile.txt afile.enc "Hello, World"
   bfish -d afile.enc afile.out "Hello, World"
@@ -62,10 +68,112 @@ for SIZE in 2048 4096 6144 8192 10250; do
     ERROR=1
   fi
 
+  echo "bfish with mapped input..."
+  bfish -e -m afile.txt afile.enc "Hello, World"
+  bfishmt -d afile.enc afile.out "Hello, World"
+  cmp afile.txt afile.out
+  if [ $? -ne 0 ]; then
+    ERROR=1
+  fi
+  bfish -d -m afile.enc afile.out "Hello, World"
+  cmp afile.txt afile.out
+  if [ $? -ne 0 ]; then
+    ERROR=1
+  fi
+
+  echo "bfish to bfishmt in counter mode..."
+  bfish -e -c afile.txt afile.enc "Hello, World"
+  bfishmt -d -c -j 4 afile.enc afile.out "Hello, World"
+  cmp afile.txt afile.out
+  if [ $? -ne 0 ]; then
+    ERROR=1
+  fi
+
+  echo "bfishmt to bfish in counter mode..."
+  bfishmt -e -c -j 4 afile.txt afile.enc "Hello, World"
+  bfish -d -c afile.enc afile.out "Hello, World"
+  cmp afile.txt afile.out
+  if [ $? -ne 0 ]; then
+    ERROR=1
+  fi
+
+  echo "bfishmt with io_uring..."
+  bfishmt -e -u 8 afile.txt afile.enc "Hello, World"
+  bfishmt -d -u 8 afile.enc afile.out "Hello, World"
+  cmp afile.txt afile.out
+  if [ $? -ne 0 ]; then
+    ERROR=1
+  fi
+
+  echo "bfishmt with io_uring in counter mode with 4 workers..."
+  bfishmt -e -c -j 4 -u 8 afile.txt afile.enc "Hello, World"
+  bfishmt -d -c -j 4 -u 8 afile.enc afile.out "Hello, World"
+  cmp afile.txt afile.out
+  if [ $? -ne 0 ]; then
+    ERROR=1
+  fi
+
+  echo "bfishmt to bfish with 64K chunks..."
+  bfishmt -e -b 64K afile.txt afile.enc "Hello, World"
+  bfish -d -b 64K afile.enc afile.out "Hello, World"
+  cmp afile.txt afile.out
+  if [ $? -ne 0 ]; then
+    ERROR=1
+  fi
+  bfishmt -e -c -b 64K afile.txt afile.enc "Hello, World"
+  bfish -d -c afile.enc afile.out "Hello, World"
+  cmp afile.txt afile.out
+  if [ $? -ne 0 ]; then
+    ERROR=1
+  fi
+
+  echo "bfish to bfishmt with automatic chunk sizes..."
+  bfish -e -b auto afile.txt afile.enc "Hello, World"
+  bfishmt -d -b auto -u 8 afile.enc afile.out "Hello, World"
+  cmp afile.txt afile.out
+  if [ $? -ne 0 ]; then
+    ERROR=1
+  fi
+
+  echo "bfishmt through pipes..."
+  cat afile.enc | bfishmt -d - - "Hello, World" > afile.out
+  cmp afile.txt afile.out
+  if [ $? -ne 0 ]; then
+    ERROR=1
+  fi
+  cat afile.txt | bfishmt -e -c -j 4 - - "Hello, World" | \
+    bfishmt -d -c -j 4 - - "Hello, World" | cat > afile.out
+  cmp afile.txt afile.out
+  if [ $? -ne 0 ]; then
+    ERROR=1
+  fi
+
+  echo "bfishmt with io_uring on standard input and output..."
+  { bfishmt -d -u 8 - - "Hello, World"; echo TRAILER; } < afile.enc > afile.out
+  echo TRAILER | cat afile.txt - | cmp - afile.out
+  if [ $? -ne 0 ]; then
+    ERROR=1
+  fi
+
+done
+
+# Batch mode, with a directory of files of all the sizes above.
+echo "bfish in batch mode..."
+rm -rf adir.txt adir.enc adir.out
+mkdir adir.txt
+for SIZE in 2048 4096 6144 8192 10250 300000; do
+  head -c $SIZE /dev/urandom > adir.txt/afile$SIZE
 done
+bfish -e -j 4 -D adir.txt adir.enc "Hello, World" > /dev/null
+bfish -d -j 4 -D adir.enc adir.out "Hello, World" > /dev/null
+diff -r adir.txt adir.out
+if [ $? -ne 0 ]; then
+  ERROR=1
+fi
 
 # Clean up.
 rm -f afile.txt afile.enc afile.out
+rm -rf adir.txt adir.enc adir.out
 
 if [ $ERROR -eq 1 ]; then
   echo 'FAIL!'
@@ -7,6 +7,32 @@ PROGRAMMER    : (C) Copyright 2008 by Peter C. Chapin
 This program allows the user to encrypt or decryption a file using the
 Blowfish algorithm.
 
+By default the file is encrypted in CFB mode with no header. The -c option
+selects the counter mode container format described in bfctr.h instead. A
+counter mode file can be partly decrypted: -r offset,length decrypts only
+the given range of plaintext bytes.
+
+The file is processed in chunks of 4096 bytes. The -b option sets another
+size, from 4K to 16M (suffixes K and M are understood), or "auto" to pick
+one from the input file's block size and length. The buffer is aligned to
+the page size or the file system's block size, whichever is larger.
+
+With -m a regular input file is mapped into memory and encrypted straight
+from the mapping into the output buffer, saving the copy that read() makes.
+Pipes and other files that can't be mapped are read as usual. The file must
+not be truncated while it is mapped or the program dies with SIGBUS.
+
+Batch mode handles many files in one run, on a pool of threads (see
+thread_pool.h) that share one key schedule. With -l the only arguments
+are a list file and the pass phrase; each line of the list names an input
+file and an output file, separated by a tab (or by spaces if there is no
+tab). Blank lines and lines starting with # are skipped. With -D the input
+and output names are directories instead: every regular file in the first
+is processed into a file of the same name in the second, which is created
+if need be and must not be the first. The -j option sets the number of threads (one per processor
+by default). Each file gets its own line of statistics, and a summary
+follows.
+
 To Do:
 
 + Consider using a better way to convert pass phrases into keys.
@@ -21,24 +47,423 @@ Please send comments or bug reports to
 ****************************************************************************/
 
 // Standard
+#include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 // Unix specific
 #include <fcntl.h>
 #include <unistd.h>
+#include <dirent.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+
+#include <pthread.h>
+#include "thread_pool.h"
 
 // OpenSSL
 #include <openssl/blowfish.h>
 
-#define BUFFER_SIZE 4096
+#include "bf_engine.h"
+#include "bfctr.h"
+#include "bfio.h"
 
 extern int optind;
+extern char *optarg;
+
+// The options, and the key, are the same for every file. Once main has
+// set them up they are only read, so the threads in batch mode can share
+// them without locking.
+//
+int  do_encrypt = 0;
+int  do_decrypt = 0;
+int  do_counter = 0;
+int  do_range   = 0;
+int  do_mmap    = 0;
+int  direction;
+long chunk_size = BFIO_DEFAULT_SIZE;
+BF_KEY key;
+unsigned long long range_offset = 0;          // Plaintext position.
+unsigned long long range_length = 0;
+
+// Used to hold information about a file being processed.
+struct file_state {
+  int in;                         // Input file handle.
+  int out;                        // Output file handle.
+  long chunk_size;                // Resolved if the option was "auto".
+  unsigned char *buffer;
+  unsigned char *mapping;         // When the input is mapped, this is all of it.
+  off_t mapping_size;
+  off_t mapping_position;
+};
+
+// One file of a batch and what became of it.
+struct job {
+  char *in_name;
+  char *out_name;
+  unsigned long long bytes;       // Input bytes processed.
+  double seconds;
+  int status;
+};
+
+
+// Map the input file from its current position on. Returns 0 or -1 if it
+// can't be mapped, in which case it should simply be read.
+//
+int map_input(struct file_state *file)
+{
+  struct stat info;
+  void *address;
+
+  if (fstat(file->in, &info) == -1 || !S_ISREG(info.st_mode) || info.st_size == 0) {
+    return -1;
+  }
+  if ((file->mapping_position = lseek(file->in, 0, SEEK_CUR)) == (off_t)-1) return -1;
+  address = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, file->in, 0);
+  if (address == MAP_FAILED) return -1;
+  madvise(address, info.st_size, MADV_SEQUENTIAL);
+  file->mapping      = address;
+  file->mapping_size = info.st_size;
+  return 0;
+}
+
+
+// Get up to max bytes of input and point *data at them. Returns the number
+// of bytes, zero at the end of the input, or -1 on error.
+//
+int get_input(struct file_state *file, unsigned char **data, int max)
+{
+  if (file->mapping == NULL) {
+    *data = file->buffer;
+    return read(file->in, file->buffer, max);
+  }
+  if (max > file->mapping_size - file->mapping_position) {
+    max = file->mapping_size - file->mapping_position;
+  }
+  *data = file->mapping + file->mapping_position;
+  file->mapping_position += max;
+  return max;
+}
+
+
+// Print an error message about a file in the style of perror.
+void file_error(const char *what, const char *name)
+{
+  fprintf(stderr, "Error %s %s: %s\n", what, name, strerror(errno));
+}
+
+
+// Encrypt or decrypt one file as the options say. Adds the number of input
+// bytes processed to *bytes. Returns 0, or -1 after printing a message.
+//
+int crypt_file(const char *in_name, const char *out_name, unsigned long long *bytes)
+{
+  struct file_state  file;
+  unsigned char      IV[8];
+  int                IV_index;
+  bfctr_header_t     header;
+  unsigned long long offset    = range_offset;
+  unsigned long long remaining = range_length;  // Bytes left in the range.
+  unsigned char     *data;                      // The input bytes to work on.
+  int                count;
+  int                status = -1;
+
+  // Prepare the IV.
+  memset(IV, 0, 8);
+  IV_index = 0;
+
+  // Open the files.
+  if ((file.in = open(in_name, O_RDONLY)) == -1) {
+    file_error("opening input file", in_name);
+    return -1;
+  }
+  if ((file.out = open(out_name, O_WRONLY|O_CREAT|O_TRUNC, 0666)) == -1) {
+    file_error("opening output file", out_name);
+    close(file.in);
+    return -1;
+  }
+
+  // Get a buffer suited to the input file.
+  file.chunk_size = chunk_size;
+  file.mapping    = NULL;
+  if (file.chunk_size == BFIO_AUTO) file.chunk_size = bfio_auto_size(file.in);
+  if ((file.buffer = bfio_alloc(file.chunk_size, bfio_alignment(file.in))) == NULL) {
+    fprintf(stderr, "Unable to allocate a buffer of %ld bytes.\n", file.chunk_size);
+    close(file.in);
+    close(file.out);
+    return -1;
+  }
+
+  if (!do_counter) {
+    if (do_mmap) map_input(&file);
+    while ((count = get_input(&file, &data, file.chunk_size)) > 0) {
+      // Decryption has the ciphertext for every block up front, so the
+      // multi-block engine can do several blocks at once.
+      //
+      if (direction == BF_DECRYPT) {
+        bf_engine_cfb64_decrypt(&key, data, file.buffer, count, IV, &IV_index);
+      }
+      else {
+        BF_cfb64_encrypt(data, file.buffer, count, &key, IV, &IV_index, direction);
+      }
+      if (bfio_write_all(file.out, file.buffer, count) == -1) {
+        file_error("writing", out_name);
+        goto done;
+      }
+      *bytes += count;
+    }
+  }
+  else {
+    // Set up the container header.
+    if (do_encrypt) {
+      if (bfctr_new_header(&header, file.chunk_size) == -1 ||
+          bfctr_write_header(file.out, &header) == -1) {
+        fprintf(stderr, "Error writing counter mode header to %s.\n", out_name);
+        goto done;
+      }
+    }
+    else {
+      if (bfctr_read_header(file.in, &header) == -1) {
+        fprintf(stderr, "Input %s is not a counter mode file.\n", in_name);
+        goto done;
+      }
+      if (do_range &&
+          lseek(file.in, BFCTR_HEADER_SIZE + offset, SEEK_SET) == (off_t)-1) {
+        file_error("seeking to range in", in_name);
+        goto done;
+      }
+    }
+
+    // Every block can be done on its own; all we need is its offset.
+    if (do_mmap) map_input(&file);
+    for (;;) {
+      count = file.chunk_size;
+      if (do_range && remaining < (unsigned long long)file.chunk_size) count = (int)remaining;
+      if (count == 0 || (count = get_input(&file, &data, count)) <= 0) break;
+
+      bfctr_crypt(&key, header.nonce, offset, data, file.buffer, count);
+      if (bfio_write_all(file.out, file.buffer, count) == -1) {
+        file_error("writing", out_name);
+        goto done;
+      }
+      *bytes += count;
+      offset += count;
+      if (do_range) remaining -= count;
+    }
+  }
+
+  // The loops end with count zero at the end of the input, and -1 on error.
+  if (count == -1) file_error("reading", in_name);
+  else status = 0;
+
+done:
+  if (file.mapping != NULL) munmap(file.mapping, file.mapping_size);
+  free(file.buffer);
+  close(file.in);
+  close(file.out);
+  return status;
+}
+
+
+// A thread pool task: one file of a batch.
+void *run_job(void *arg)
+{
+  struct job *job = (struct job *)arg;
+  struct timespec start;
+  struct timespec stop;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  job->status = crypt_file(job->in_name, job->out_name, &job->bytes);
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+  job->seconds = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+  return NULL;
+}
+
+
+// Add a file to the batch. The names are copied. Returns 0 or -1 if memory
+// runs out.
+//
+int add_job(struct job **jobs, int *count, int *size, const char *in_name, const char *out_name)
+{
+  struct job *bigger;
+
+  if (*count == *size) {
+    *size = 2 * *size + 16;
+    if ((bigger = realloc(*jobs, *size * sizeof(struct job))) == NULL) return -1;
+    *jobs = bigger;
+  }
+  (*jobs)[*count].in_name  = strdup(in_name);
+  (*jobs)[*count].out_name = strdup(out_name);
+  (*jobs)[*count].bytes    = 0;
+  (*jobs)[*count].seconds  = 0.0;
+  (*jobs)[*count].status   = -1;
+  if ((*jobs)[*count].in_name == NULL || (*jobs)[*count].out_name == NULL) return -1;
+  (*count)++;
+  return 0;
+}
+
+
+// Read the pairs of file names in a list file. Returns 0 or -1 on error.
+int read_list(const char *list_name, struct job **jobs, int *count, int *size)
+{
+  FILE   *list;
+  char   *line = NULL;
+  size_t  line_size = 0;
+  ssize_t length;
+  char   *second;
+  int     line_number = 0;
+  int     status = 0;
+
+  if ((list = fopen(list_name, "r")) == NULL) {
+    file_error("opening list", list_name);
+    return -1;
+  }
+  while (status == 0 && (length = getline(&line, &line_size, list)) != -1) {
+    line_number++;
+    while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) {
+      line[--length] = '\0';
+    }
+    if (length == 0 || line[0] == '#') continue;
+
+    // Split at a tab if there is one so that names can contain spaces.
+    if ((second = strchr(line, '\t')) == NULL) second = strchr(line, ' ');
+    if (second == NULL) {
+      fprintf(stderr, "%s:%d: expected an input and an output file name.\n",
+              list_name, line_number);
+      status = -1;
+      break;
+    }
+    *second++ = '\0';
+    while (*second == ' ' || *second == '\t') second++;
+    if (*second == '\0') {
+      fprintf(stderr, "%s:%d: expected an input and an output file name.\n",
+              list_name, line_number);
+      status = -1;
+      break;
+    }
+    if (add_job(jobs, count, size, line, second) == -1) {
+      fprintf(stderr, "Out of memory reading %s.\n", list_name);
+      status = -1;
+    }
+  }
+  free(line);
+  fclose(list);
+  return status;
+}
+
+
+// Make a job for every regular file in a directory. Returns 0 or -1 on error.
+int read_directory(const char *in_dir, const char *out_dir,
+                   struct job **jobs, int *count, int *size)
+{
+  DIR           *directory;
+  struct dirent *entry;
+  struct stat    info;
+  struct stat    out_info;
+  char          *in_name;
+  char          *out_name;
+  int            status = 0;
 
-char buffer[BUFFER_SIZE];
-int  count;
+  if ((directory = opendir(in_dir)) == NULL) {
+    file_error("opening directory", in_dir);
+    return -1;
+  }
+  if (mkdir(out_dir, 0777) == -1 && errno != EEXIST) {
+    file_error("creating directory", out_dir);
+    closedir(directory);
+    return -1;
+  }
+
+  // Each output would truncate its own input before it was read.
+  if (stat(in_dir, &info) == 0 && stat(out_dir, &out_info) == 0 &&
+      info.st_dev == out_info.st_dev && info.st_ino == out_info.st_ino) {
+    fprintf(stderr, "%s and %s are the same directory.\n", in_dir, out_dir);
+    closedir(directory);
+    return -1;
+  }
+  while (status == 0 && (entry = readdir(directory)) != NULL) {
+    in_name  = malloc(strlen(in_dir) + strlen(entry->d_name) + 2);
+    out_name = malloc(strlen(out_dir) + strlen(entry->d_name) + 2);
+    if (in_name == NULL || out_name == NULL) {
+      fprintf(stderr, "Out of memory reading %s.\n", in_dir);
+      status = -1;
+    }
+    else {
+      sprintf(in_name, "%s/%s", in_dir, entry->d_name);
+      sprintf(out_name, "%s/%s", out_dir, entry->d_name);
+      if (stat(in_name, &info) == 0 && S_ISREG(info.st_mode) &&
+          add_job(jobs, count, size, in_name, out_name) == -1) {
+        fprintf(stderr, "Out of memory reading %s.\n", in_dir);
+        status = -1;
+      }
+    }
+    free(in_name);
+    free(out_name);
+  }
+  closedir(directory);
+  return status;
+}
+
+
+// Process the jobs on a pool of threads, then report on them. Returns the
+// number of files that failed, or -1 if the pool can't be had.
+//
+int run_batch(struct job *jobs, int count, int thread_count)
+{
+  thread_pool_t          pool;
+  thread_pool_future_t **futures;
+  struct timespec        start;
+  struct timespec        stop;
+  unsigned long long     total = 0;
+  double                 elapsed;
+  double                 busy = 0.0;
+  int                    failures = 0;
+  int                    i;
+
+  if ((futures = malloc((count + 1) * sizeof(thread_pool_future_t *))) == NULL ||
+      thread_pool_init(&pool, thread_count, 2 * thread_count) == -1) {
+    fprintf(stderr, "Unable to start %d threads.\n", thread_count);
+    free(futures);
+    return -1;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (i = 0; i < count; i++) {
+    futures[i] = thread_pool_submit(&pool, run_job, &jobs[i]);
+  }
+
+  // Report in list order. A NULL future means the job couldn't be submitted.
+  for (i = 0; i < count; i++) {
+    if (futures[i] != NULL) {
+      thread_pool_future_get(futures[i], NULL);
+      thread_pool_future_release(futures[i]);
+    }
+    if (jobs[i].status != 0) {
+      failures++;
+      printf("%s -> %s: FAILED\n", jobs[i].in_name, jobs[i].out_name);
+      continue;
+    }
+    printf("%s -> %s: %llu bytes in %.3f s (%.1f MB/s)\n",
+           jobs[i].in_name, jobs[i].out_name, jobs[i].bytes, jobs[i].seconds,
+           (jobs[i].seconds > 0.0) ? jobs[i].bytes / jobs[i].seconds / 1e6 : 0.0);
+    total += jobs[i].bytes;
+    busy  += jobs[i].seconds;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+  thread_pool_shutdown(&pool, THREAD_POOL_GRACEFUL);
+  free(futures);
+
+  elapsed = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+  printf("%d files (%d failed), %llu bytes in %.3f s on %d thread%s: "
+         "%.1f MB/s overall, %.1f MB/s per busy thread\n",
+         count, failures, total, elapsed, thread_count, (thread_count == 1) ? "" : "s",
+         (elapsed > 0.0) ? total / elapsed / 1e6 : 0.0,
+         (busy > 0.0) ? total / busy / 1e6 : 0.0);
+  return failures;
+}
 
 // ============
 // Main Program
@@ -47,26 +472,53 @@ int  count;
 int main(int argc, char **argv)
 {
   int  option;
-  int  do_encrypt = 0;
-  int  do_decrypt = 0;
-  int  direction;
-  int  in;            // Input file handle.
-  int  out;           // Output file handle.
+  int  do_directory = 0;
+  int  thread_count = 0;
+  char *list_name   = NULL;
   unsigned char raw_key[16];
-  BF_KEY        key;
-  unsigned char IV[8];
-  int           IV_index;
+  unsigned long long bytes = 0;
+  char *end;
+  struct job *jobs = NULL;
+  int  job_count   = 0;
+  int  job_size    = 0;
+  int  status;
+  int  i;
 
-  while ((option = getopt(argc, argv, "ed")) != -1) {
+  while ((option = getopt(argc, argv, "edcmr:b:l:Dj:")) != -1) {
     switch (option) {
       case 'e': do_encrypt = 1; direction = BF_ENCRYPT; break;
       case 'd': do_decrypt = 1; direction = BF_DECRYPT; break;
+      case 'c': do_counter = 1; break;
+      case 'm': do_mmap    = 1; break;
+      case 'r':
+        do_range     = 1;
+        range_offset = strtoull(optarg, &end, 0);
+        if (end == optarg || *end != ',' || *(end + 1) == '\0') end = optarg;
+        else range_length = strtoull(end + 1, &end, 0);
+        if (end == optarg || *end != '\0') {
+          fprintf(stderr, "The range must be given as offset,length.\n");
+          return 1;
+        }
+        break;
+      case 'b':
+        if ((chunk_size = bfio_parse_size(optarg)) == -1) {
+          fprintf(stderr, "The chunk size must be from 4K to 16M, or auto.\n");
+          return 1;
+        }
+        break;
+      case 'l': list_name    = optarg; break;
+      case 'D': do_directory = 1; break;
+      case 'j': thread_count = atoi(optarg); break;
     }
   }
 
-  if (argc - optind != 3) {
+  if (argc - optind != ((list_name != NULL) ? 1 : 3) || (list_name != NULL && do_directory)) {
     fprintf(stderr,
-      "Usage: %s -e|-d infile outfile \"pass phrase\"\n", argv[0]);
+      "Usage: %s -e|-d [-c] [-m] [-r offset,length] [-b size|auto] "
+      "infile outfile \"pass phrase\"\n"
+      "       %s -e|-d [-c] [-m] [-b size|auto] [-j threads] "
+      "-l listfile | -D indir outdir \"pass phrase\"\n",
+      argv[0], argv[0]);
     return 1;
   }
 
@@ -76,35 +528,43 @@ int main(int argc, char **argv)
     return 1;
   }
 
-  // Prepare the key.
-  strncpy(raw_key, argv[optind + 2], 16);
+  if (do_range && !(do_decrypt && do_counter)) {
+    fprintf(stderr, "A range can only be decrypted from a counter mode file.\n");
+    return 1;
+  }
+
+  if (do_range && (list_name != NULL || do_directory)) {
+    fprintf(stderr, "A range can't be used with a batch of files.\n");
+    return 1;
+  }
+
+  // Prepare the key. It's the same for every file, so it's done just once.
+  strncpy((char *)raw_key, argv[argc - 1], 16);
   BF_set_key(&key, 16, raw_key);
 
-  // Prepare the IV.
-  memset(IV, 0, 8);
-  IV_index = 0;
+  if (list_name == NULL && !do_directory) {
+    return (crypt_file(argv[optind + 0], argv[optind + 1], &bytes) == 0) ? 0 : 1;
+  }
 
-  // Open the files.
-  if ((in = open(argv[optind + 0], O_RDONLY)) == -1) {
-    perror("Error opening input file");
+  // Batch mode.
+  if (thread_count == 0) thread_count = sysconf(_SC_NPROCESSORS_ONLN);
+  if (thread_count < 1) {
+    fprintf(stderr, "The number of threads must be at least one.\n");
     return 1;
   }
-  if ((out = open(argv[optind + 1], O_WRONLY|O_CREAT|O_TRUNC, 0666)) == -1) {
-    perror("Error opening output file");
-    close(in);
-    return 1;
+  if (list_name != NULL) {
+    status = read_list(list_name, &jobs, &job_count, &job_size);
   }
-  
-  while ((count = read(in, buffer, BUFFER_SIZE)) > 0) {
-    BF_cfb64_encrypt(buffer, buffer, count, &key, IV, &IV_index, direction);
-    if (write(out, buffer, count) != count) {
-      perror("Error writing output");
-      break;
-    }
+  else {
+    status = read_directory(argv[optind + 0], argv[optind + 1], &jobs, &job_count, &job_size);
   }
-  
-  close(in);
-  close(out);
-  
-  return 0;
+  if (status == 0) status = run_batch(jobs, job_count, thread_count);
+
+  for (i = 0; i < job_count; i++) {
+    free(jobs[i].in_name);
+    free(jobs[i].out_name);
+  }
+  free(jobs);
+
+  return (status == 0) ? 0 : 1;
 }
@@ -0,0 +1,710 @@
+/****************************************************************************
+FILE          : bfish_bench.c
+SUBJECT       : Measure the throughput of bfish and bfishmt.
+PROGRAMMER    : (C) Copyright 2026 by Peter C. Chapin <pcc482719@gmail.com>
+
+For each data size the program generates pseudo-random data in memory and
+writes it to a file in a scratch directory, by default /dev/shm so the
+disk doesn't set the pace. It then runs the programs on the file, each as
+a child process, sweeping the options that matter:
+
+  - bfish: CFB and counter mode, each chunk size, with and without -m.
+  - bfish in batch mode (-D): CFB and counter mode, each chunk size and
+    worker count, on a directory holding the data split into four files.
+  - bfishmt: CFB and counter mode, each chunk size, queue depth, worker
+    count and io_uring depth (0 meaning ordinary system calls). CFB
+    encryption only ever has one worker, so only -j 1 is run for it.
+  - bfishmt streaming (- for both files) through pipes that other
+    processes fill from the data file and empty into the output file,
+    for each chunk size, queue depth and worker count.
+
+A chunk size of "auto" lets the programs choose. Every combination is run
+both ways. Decryption reads a file encrypted beforehand, and its output is
+compared with the original data. So is the output of CFB encryption,
+which should match the reference ciphertext.
+Each measurement is the fastest of the repeats. The process's CPU time
+and peak resident set size come from wait4().
+
+The results go to standard output as CSV, one line per run, for tracking
+regressions with whatever tools are at hand. Progress and skipped sizes
+are reported on standard error. A size is skipped if the scratch file
+system can't hold four copies of the data.
+
+Usage: bfish_bench [-p bindir] [-t scratchdir] [-r repeats] [-s sizes]
+                   [-b chunks] [-q depths] [-j workers] [-u depths]
+
+Lists are comma separated. Sizes and chunks take K, M or G suffixes, and
+the chunk list may include auto; depths and worker counts are plain
+numbers. The default sizes are 1M,16M,64M; up to 4G is allowed when there
+is room for it.
+
+Build with:
+  gcc -O2 -o bfish_bench bfish_bench.c
+****************************************************************************/
+
+#define _DEFAULT_SOURCE  // For wait4.
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#define MAX_LIST    16
+#define MAX_SIZE    ( 4LL * 1024 * 1024 * 1024 )
+#define FILL_BLOCK  ( 1024 * 1024 )
+#define PASS_PHRASE "Hello, World"
+#define AUTO_CHUNK  0    // Stands for -b auto in a chunk list.
+#define BATCH_FILES 4    // Files the data is split into for batch mode.
+
+typedef struct {
+    long long value[MAX_LIST];
+    int       count;
+} list_t;
+
+// One run of one of the programs.
+typedef struct {
+    int  multithreaded;  // bfishmt rather than bfish.
+    int  counter;
+    int  decrypt;
+    long chunk;
+    int  queue;
+    int  workers;
+    int  uring;
+    int  mmap;
+    int  stream;         // bfishmt with - for both files, fed and emptied through pipes.
+    int  batch;          // bfish -D on directories of BATCH_FILES files.
+} config_t;
+
+typedef struct {
+    double wall;
+    double user;
+    double sys;
+    long   max_rss;      // Kilobytes.
+    int    exit_status;  // -1 if the program didn't exit normally.
+} result_t;
+
+static const char *bin_dir     = ".";
+static const char *scratch_dir = "/dev/shm";
+static int         repeats     = 3;
+
+
+static double now( void )
+{
+    struct timespec t;
+
+    clock_gettime( CLOCK_MONOTONIC, &t );
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+
+// Parse a size with an optional K, M or G suffix. Returns -1 if it isn't one.
+static long long parse_size( const char *text )
+{
+    char     *end;
+    long long size = strtoll( text, &end, 10 );
+
+    if( end == text || size < 0 ) return -1;
+    switch( *end ) {
+    case 'k': case 'K': size <<= 10; end++; break;
+    case 'm': case 'M': size <<= 20; end++; break;
+    case 'g': case 'G': size <<= 30; end++; break;
+    default: break;
+    }
+    return ( *end == '\0' ) ? size : -1;
+}
+
+
+// Parse a chunk size, or auto. Returns -1 if it is neither.
+static long long parse_chunk( const char *text )
+{
+    long long size;
+
+    if( strcmp( text, "auto" ) == 0 ) return AUTO_CHUNK;
+    size = parse_size( text );
+    return ( size == 0 ) ? -1 : size;
+}
+
+
+// Parse a plain count. Returns -1 if it isn't one.
+static long long parse_count( const char *text )
+{
+    char     *end;
+    long long count = strtoll( text, &end, 10 );
+
+    return ( end == text || *end != '\0' || count < 0 ) ? -1 : count;
+}
+
+
+// Parse a comma separated list of items. Returns 0 or -1 if the text isn't one.
+static int parse_list( const char *text, list_t *list, long long ( *parse )( const char * ) )
+{
+    char  copy[256];
+    char *item;
+    char *rest;
+
+    if( strlen( text ) >= sizeof( copy ) ) return -1;
+    strcpy( copy, text );
+    list->count = 0;
+    for( item = strtok_r( copy, ",", &rest ); item != NULL; item = strtok_r( NULL, ",", &rest ) ) {
+        if( list->count == MAX_LIST || ( list->value[list->count] = parse( item ) ) == -1 ) {
+            return -1;
+        }
+        list->count++;
+    }
+    return ( list->count > 0 ) ? 0 : -1;
+}
+
+
+static void make_path( char *path, size_t size, const char *name )
+{
+    snprintf( path, size, "%s/bfish_bench.%ld.%s", scratch_dir, (long)getpid( ), name );
+}
+
+
+// Write size bytes of xorshift output to a new file. Returns 0 or -1 on error.
+static int generate( const char *path, long long size )
+{
+    static unsigned long long block[FILL_BLOCK / 8];
+    unsigned long long state = 0x9E3779B97F4A7C15ULL;
+    long long          left;
+    size_t             count;
+    size_t             i;
+    int                fd;
+
+    if( ( fd = open( path, O_WRONLY | O_CREAT | O_TRUNC, 0600 ) ) == -1 ) return -1;
+    for( left = size; left > 0; left -= count ) {
+        for( i = 0; i < FILL_BLOCK / 8; ++i ) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            block[i] = state;
+        }
+        count = ( left < FILL_BLOCK ) ? (size_t)left : FILL_BLOCK;
+        if( write( fd, block, count ) != (ssize_t)count ) {
+            close( fd );
+            return -1;
+        }
+    }
+    return close( fd );
+}
+
+
+static void make_batch_path( char *path, size_t size, const char *directory, int file )
+{
+    snprintf( path, size, "%.1000s/f%d", directory, file );
+}
+
+
+// Returns 1 if the two files hold the same bytes.
+static int same_file( const char *path1, const char *path2 )
+{
+    static char buffer1[FILL_BLOCK];
+    static char buffer2[FILL_BLOCK];
+    FILE  *file1 = fopen( path1, "rb" );
+    FILE  *file2 = fopen( path2, "rb" );
+    size_t count1;
+    size_t count2;
+    int    same = ( file1 != NULL && file2 != NULL );
+
+    while( same ) {
+        count1 = fread( buffer1, 1, FILL_BLOCK, file1 );
+        count2 = fread( buffer2, 1, FILL_BLOCK, file2 );
+        if( count1 != count2 || memcmp( buffer1, buffer2, count1 ) != 0 ) same = 0;
+        if( count1 == 0 ) break;
+    }
+    if( file1 != NULL ) fclose( file1 );
+    if( file2 != NULL ) fclose( file2 );
+    return same;
+}
+
+
+// Like same_file, but for the files of two batch mode directories when batch is set.
+static int same_output( const char *path1, const char *path2, int batch )
+{
+    char file1[1024];
+    char file2[1024];
+    int  i;
+
+    if( !batch ) return same_file( path1, path2 );
+    for( i = 0; i < BATCH_FILES; ++i ) {
+        make_batch_path( file1, sizeof( file1 ), path1, i );
+        make_batch_path( file2, sizeof( file2 ), path2, i );
+        if( !same_file( file1, file2 ) ) return 0;
+    }
+    return 1;
+}
+
+
+// Copy from one descriptor to another until the end of the input.
+static void copy_fd( int from, int to )
+{
+    static char buffer[FILL_BLOCK];
+    ssize_t     count;
+    ssize_t     written;
+    ssize_t     done;
+
+    while( ( count = read( from, buffer, sizeof( buffer ) ) ) > 0 ) {
+        for( done = 0; done < count; done += written ) {
+            if( ( written = write( to, buffer + done, count - done ) ) == -1 ) return;
+        }
+    }
+}
+
+
+// Start a process that fills a pipe from a file or, if writing is set, empties one into it. The
+// other pipe ends are closed in the child so the pipes see their ends of file. Returns the
+// process ID or -1.
+//
+static pid_t start_copier( const char *path, int writing, int pipe_end, const int pipes[4] )
+{
+    pid_t pid;
+    int   fd;
+    int   i;
+
+    if( ( pid = fork( ) ) != 0 ) return pid;
+    for( i = 0; i < 4; ++i ) {
+        if( pipes[i] != pipe_end ) close( pipes[i] );
+    }
+    fd = writing ? open( path, O_WRONLY | O_CREAT | O_TRUNC, 0600 ) : open( path, O_RDONLY );
+    if( fd == -1 ) {
+        perror( path );
+        _exit( 127 );
+    }
+    if( writing ) copy_fd( pipe_end, fd );
+    else copy_fd( fd, pipe_end );
+    _exit( 0 );
+}
+
+
+// Run a program and wait for it. Its standard output is thrown away unless in is given; then
+// its standard input is a pipe filled from in and its standard output a pipe emptied into out.
+// The time includes emptying the output pipe.
+//
+static void run( char **argv, const char *in, const char *out, result_t *result )
+{
+    struct rusage usage;
+    pid_t  pid;
+    pid_t  feeder  = -1;
+    pid_t  drainer = -1;
+    int    pipes[4] = { -1, -1, -1, -1 };  // The program's input pipe, then its output pipe.
+    int    status;
+    int    null_fd;
+    int    i;
+    double start = now( );
+
+    result->exit_status = -1;
+    if( in != NULL ) {
+        if( pipe( pipes ) == -1 || pipe( pipes + 2 ) == -1 ) {
+            perror( "pipe" );
+            for( i = 0; i < 4; ++i ) {
+                if( pipes[i] != -1 ) close( pipes[i] );
+            }
+            return;
+        }
+        feeder  = start_copier( in, 0, pipes[1], pipes );
+        drainer = start_copier( out, 1, pipes[2], pipes );
+    }
+    if( ( pid = fork( ) ) == 0 ) {
+        if( in != NULL ) {
+            dup2( pipes[0], STDIN_FILENO );
+            dup2( pipes[3], STDOUT_FILENO );
+        }
+        else if( ( null_fd = open( "/dev/null", O_WRONLY ) ) != -1 ) {
+            dup2( null_fd, STDOUT_FILENO );
+        }
+        for( i = 0; i < 4; ++i ) {
+            if( pipes[i] != -1 ) close( pipes[i] );
+        }
+        execv( argv[0], argv );
+        perror( argv[0] );
+        _exit( 127 );
+    }
+    for( i = 0; i < 4; ++i ) {
+        if( pipes[i] != -1 ) close( pipes[i] );
+    }
+    if( feeder != -1 ) waitpid( feeder, NULL, 0 );
+    if( drainer != -1 ) waitpid( drainer, NULL, 0 );
+    if( pid == -1 || ( in != NULL && ( feeder == -1 || drainer == -1 ) ) ) {
+        perror( "fork" );
+        if( pid != -1 ) waitpid( pid, NULL, 0 );
+        return;
+    }
+    if( wait4( pid, &status, 0, &usage ) == -1 ) {
+        perror( "wait4" );
+        return;
+    }
+    result->wall    = now( ) - start;
+    result->user    = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6;
+    result->sys     = usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    result->max_rss = usage.ru_maxrss;
+    if( WIFEXITED( status ) ) result->exit_status = WEXITSTATUS( status );
+}
+
+
+// Build the command line for a configuration and run it, keeping the fastest of the repeats.
+static void measure( const config_t *c, const char *in, const char *out, result_t *best )
+{
+    char  program[1024];
+    char  chunk[32], queue[32], workers[32], uring[32];
+    char *argv[24];
+    int   argc = 0;
+    int   i;
+    result_t result;
+
+    snprintf( program, sizeof( program ), "%s/%s", bin_dir, c->multithreaded ? "bfishmt" : "bfish" );
+    if( c->chunk == AUTO_CHUNK ) strcpy( chunk, "auto" );
+    else snprintf( chunk, sizeof( chunk ), "%ld", c->chunk );
+    argv[argc++] = program;
+    argv[argc++] = c->decrypt ? "-d" : "-e";
+    if( c->counter ) argv[argc++] = "-c";
+    argv[argc++] = "-b";
+    argv[argc++] = chunk;
+    if( c->batch ) {
+        snprintf( workers, sizeof( workers ), "%d", c->workers );
+        argv[argc++] = "-j";
+        argv[argc++] = workers;
+        argv[argc++] = "-D";
+    }
+    if( c->multithreaded ) {
+        snprintf( queue, sizeof( queue ), "%d", c->queue );
+        snprintf( workers, sizeof( workers ), "%d", c->workers );
+        argv[argc++] = "-q";
+        argv[argc++] = queue;
+        argv[argc++] = "-j";
+        argv[argc++] = workers;
+        if( c->uring > 0 ) {
+            snprintf( uring, sizeof( uring ), "%d", c->uring );
+            argv[argc++] = "-u";
+            argv[argc++] = uring;
+        }
+    }
+    if( c->mmap ) argv[argc++] = "-m";
+    argv[argc++] = c->stream ? "-" : (char *)in;
+    argv[argc++] = c->stream ? "-" : (char *)out;
+    argv[argc++] = PASS_PHRASE;
+    argv[argc]   = NULL;
+
+    for( i = 0; i < repeats; ++i ) {
+        run( argv, c->stream ? in : NULL, out, &result );
+        if( i == 0 || result.exit_status != 0 || ( best->exit_status == 0 && result.wall < best->wall ) ) {
+            *best = result;
+        }
+        if( result.exit_status != 0 ) break;
+    }
+}
+
+
+// Run one configuration on the data and print its line.
+static void bench( const config_t *c, long long size, const char *plain, const char *reference,
+                   const char *output )
+{
+    char     cipher[1024];
+    result_t result;
+    const char *verified = "n/a";
+
+    // Decryption reads the file (or directory) prepared beforehand in the same mode.
+    if( c->decrypt ) {
+        if( c->batch ) make_path( cipher, sizeof( cipher ), c->counter ? "batch.ctr" : "batch.cfb" );
+        else make_path( cipher, sizeof( cipher ), c->counter ? "ctr" : "cfb" );
+        measure( c, cipher, output, &result );
+        if( result.exit_status == 0 ) {
+            verified = same_output( output, plain, c->batch ) ? "ok" : "WRONG";
+        }
+    }
+    else {
+        measure( c, plain, output, &result );
+        if( result.exit_status == 0 && !c->counter ) {
+            verified = same_output( output, reference, c->batch ) ? "ok" : "WRONG";
+        }
+    }
+
+    printf( "%s,%s,%s,%s,%lld,", c->multithreaded ? "bfishmt" : "bfish",
+            c->batch ? "batch" : c->stream ? "pipe" : "file", c->counter ? "ctr" : "cfb",
+            c->decrypt ? "decrypt" : "encrypt", size );
+    if( c->chunk == AUTO_CHUNK ) printf( "auto," );
+    else printf( "%ld,", c->chunk );
+    printf( "%d,%d,%d,%d,", c->queue, c->workers, c->uring, c->mmap );
+    if( result.exit_status == 0 ) {
+        printf( "%.4f,%.1f,%.3f,%.3f,%ld,0,%s\n", result.wall,
+                ( result.wall > 0.0 ) ? size / result.wall / 1e6 : 0.0,
+                result.user, result.sys, result.max_rss, verified );
+    }
+    else {
+        printf( ",,,,,%d,failed\n", result.exit_status );
+    }
+    fflush( stdout );
+}
+
+
+// Prepare the inputs for one size: the data, the CFB reference ciphertext and a counter mode
+// file. Returns 0 or -1 on error.
+//
+static int prepare( long long size, const char *plain, const char *reference )
+{
+    char     cipher[1024];
+    char     program[1024];
+    char    *argv[8];
+    result_t result;
+
+    if( generate( plain, size ) == -1 ) return -1;
+
+    snprintf( program, sizeof( program ), "%s/bfish", bin_dir );
+    argv[0] = program;
+    argv[1] = "-e";
+    argv[2] = (char *)plain;
+    argv[3] = (char *)reference;
+    argv[4] = PASS_PHRASE;
+    argv[5] = NULL;
+    run( argv, NULL, NULL, &result );
+    if( result.exit_status != 0 ) return -1;
+
+    make_path( cipher, sizeof( cipher ), "cfb" );
+    if( link( reference, cipher ) == -1 ) return -1;
+
+    make_path( cipher, sizeof( cipher ), "ctr" );
+    argv[2] = "-c";
+    argv[3] = (char *)plain;
+    argv[4] = cipher;
+    argv[5] = PASS_PHRASE;
+    argv[6] = NULL;
+    run( argv, NULL, NULL, &result );
+    return ( result.exit_status == 0 ) ? 0 : -1;
+}
+
+
+// Prepare the directories for batch mode: the data split into BATCH_FILES files, and those
+// files encrypted in each mode. Returns 0 or -1 on error.
+//
+static int prepare_batch( long long size )
+{
+    char     plain[1024];
+    char     cipher[1024];
+    char     file[1024];
+    char     program[1024];
+    char    *argv[10];
+    long long part = size / BATCH_FILES;
+    result_t result;
+    int      i;
+
+    make_path( plain, sizeof( plain ), "batch.plain" );
+    if( mkdir( plain, 0700 ) == -1 ) return -1;
+    for( i = 0; i < BATCH_FILES; ++i ) {
+        make_batch_path( file, sizeof( file ), plain, i );
+        if( generate( file, ( i == BATCH_FILES - 1 ) ? size - i * part : part ) == -1 ) return -1;
+    }
+
+    snprintf( program, sizeof( program ), "%s/bfish", bin_dir );
+    argv[0] = program;
+    argv[1] = "-e";
+    argv[2] = "-D";
+    argv[3] = plain;
+    argv[4] = cipher;
+    argv[5] = PASS_PHRASE;
+    argv[6] = NULL;
+    make_path( cipher, sizeof( cipher ), "batch.cfb" );
+    run( argv, NULL, NULL, &result );
+    if( result.exit_status != 0 ) return -1;
+
+    argv[2] = "-c";
+    argv[3] = "-D";
+    argv[4] = plain;
+    argv[5] = cipher;
+    argv[6] = PASS_PHRASE;
+    argv[7] = NULL;
+    make_path( cipher, sizeof( cipher ), "batch.ctr" );
+    run( argv, NULL, NULL, &result );
+    return ( result.exit_status == 0 ) ? 0 : -1;
+}
+
+
+static void clean_up( void )
+{
+    static const char *names[] = { "plain", "reference", "cfb", "ctr", "out" };
+    char   path[1024];
+    size_t i;
+
+    for( i = 0; i < sizeof( names ) / sizeof( names[0] ); ++i ) {
+        make_path( path, sizeof( path ), names[i] );
+        unlink( path );
+    }
+}
+
+
+static void clean_up_batch( void )
+{
+    static const char *names[] = { "batch.plain", "batch.cfb", "batch.ctr", "batch.out" };
+    char   directory[1024];
+    char   path[1024];
+    size_t i;
+    int    j;
+
+    for( i = 0; i < sizeof( names ) / sizeof( names[0] ); ++i ) {
+        make_path( directory, sizeof( directory ), names[i] );
+        for( j = 0; j < BATCH_FILES; ++j ) {
+            make_batch_path( path, sizeof( path ), directory, j );
+            unlink( path );
+        }
+        rmdir( directory );
+    }
+}
+
+
+// Returns 1 if the scratch file system has room for the data, a ciphertext file for each mode
+// and the output. The batch mode directories hold as much, but only after the files are gone.
+//
+static int room_for( long long size )
+{
+    struct statvfs info;
+
+    if( statvfs( scratch_dir, &info ) == -1 ) return 0;
+    return (long long)( info.f_bavail * info.f_frsize ) > 4 * size + 64LL * 1024 * 1024;
+}
+
+
+int main( int argc, char **argv )
+{
+    list_t   sizes, chunks, queues, workers, urings;
+    config_t c;
+    char     plain[1024];
+    char     reference[1024];
+    char     output[1024];
+    char     batch_plain[1024];
+    char     batch_reference[1024];
+    char     batch_output[1024];
+    int      option;
+    int      s, b, q, j, u;
+    long     cpus = sysconf( _SC_NPROCESSORS_ONLN );
+    char     default_workers[32];
+
+    snprintf( default_workers, sizeof( default_workers ), "1,%ld", ( cpus > 1 ) ? cpus : 2 );
+    parse_list( "1M,16M,64M", &sizes, parse_size );
+    parse_list( "4K,64K,1M,auto", &chunks, parse_chunk );
+    parse_list( "16,64", &queues, parse_count );
+    parse_list( default_workers, &workers, parse_count );
+    parse_list( "0,32", &urings, parse_count );
+
+    while( ( option = getopt( argc, argv, "p:t:r:s:b:q:j:u:" ) ) != -1 ) {
+        int error = 0;
+
+        switch( option ) {
+        case 'p': bin_dir     = optarg; break;
+        case 't': scratch_dir = optarg; break;
+        case 'r': repeats     = atoi( optarg ); error = ( repeats < 1 ); break;
+        case 's': error = parse_list( optarg, &sizes, parse_size ); break;
+        case 'b': error = parse_list( optarg, &chunks, parse_chunk ); break;
+        case 'q': error = parse_list( optarg, &queues, parse_count ); break;
+        case 'j': error = parse_list( optarg, &workers, parse_count ); break;
+        case 'u': error = parse_list( optarg, &urings, parse_count ); break;
+        default:  error = 1; break;
+        }
+        if( error ) {
+            fprintf( stderr, "Usage: %s [-p bindir] [-t scratchdir] [-r repeats] [-s sizes]\n"
+                             "       [-b chunks] [-q depths] [-j workers] [-u depths]\n", argv[0] );
+            return EXIT_FAILURE;
+        }
+    }
+
+    make_path( plain, sizeof( plain ), "plain" );
+    make_path( reference, sizeof( reference ), "reference" );
+    make_path( output, sizeof( output ), "out" );
+
+    printf( "program,io,mode,op,bytes,chunk,queue,workers,uring,mmap,"
+            "wall_s,mb_per_s,user_s,sys_s,max_rss_kb,exit,verified\n" );
+    for( s = 0; s < sizes.count; ++s ) {
+        long long size = sizes.value[s];
+
+        if( size < 1 || size > MAX_SIZE ) {
+            fprintf( stderr, "Skipping %lld bytes: sizes must be from 1 byte to 4G\n", size );
+            continue;
+        }
+        if( !room_for( size ) ) {
+            fprintf( stderr, "Skipping %lld bytes: not enough room in %s\n", size, scratch_dir );
+            continue;
+        }
+        fprintf( stderr, "Preparing %lld bytes\n", size );
+        if( prepare( size, plain, reference ) == -1 ) {
+            fprintf( stderr, "Unable to prepare the data in %s (are the programs in %s?)\n",
+                     scratch_dir, bin_dir );
+            clean_up( );
+            return EXIT_FAILURE;
+        }
+
+        memset( &c, 0, sizeof( c ) );
+        for( c.counter = 0; c.counter <= 1; ++c.counter ) {
+            for( c.decrypt = 0; c.decrypt <= 1; ++c.decrypt ) {
+                fprintf( stderr, "  %s %s\n", c.counter ? "ctr" : "cfb", c.decrypt ? "decrypt" : "encrypt" );
+                for( b = 0; b < chunks.count; ++b ) {
+                    c.chunk = (long)chunks.value[b];
+
+                    // The sequential program.
+                    c.multithreaded = 0;
+                    c.queue = c.uring = 0;
+                    c.workers = 1;
+                    for( c.mmap = 0; c.mmap <= 1; ++c.mmap ) bench( &c, size, plain, reference, output );
+
+                    // The pipeline.
+                    c.multithreaded = 1;
+                    c.mmap = 0;
+                    for( q = 0; q < queues.count; ++q ) {
+                        for( j = 0; j < workers.count; ++j ) {
+                            for( u = 0; u < urings.count; ++u ) {
+                                c.queue   = (int)queues.value[q];
+                                c.workers = (int)workers.value[j];
+                                c.uring   = (int)urings.value[u];
+                                if( !c.counter && !c.decrypt && c.workers != 1 ) continue;
+                                bench( &c, size, plain, reference, output );
+                            }
+                        }
+                    }
+
+                    // The pipeline in a shell pipeline.
+                    c.stream = 1;
+                    c.uring  = 0;
+                    for( q = 0; q < queues.count; ++q ) {
+                        for( j = 0; j < workers.count; ++j ) {
+                            c.queue   = (int)queues.value[q];
+                            c.workers = (int)workers.value[j];
+                            if( !c.counter && !c.decrypt && c.workers != 1 ) continue;
+                            bench( &c, size, plain, reference, output );
+                        }
+                    }
+                    c.stream = 0;
+                }
+            }
+        }
+        clean_up( );
+
+        // The sequential program in batch mode, on a thread per file.
+        fprintf( stderr, "  batch mode\n" );
+        if( prepare_batch( size ) == -1 ) {
+            fprintf( stderr, "Unable to prepare the batch directories in %s\n", scratch_dir );
+            clean_up_batch( );
+            return EXIT_FAILURE;
+        }
+        make_path( batch_plain, sizeof( batch_plain ), "batch.plain" );
+        make_path( batch_reference, sizeof( batch_reference ), "batch.cfb" );
+        make_path( batch_output, sizeof( batch_output ), "batch.out" );
+        memset( &c, 0, sizeof( c ) );
+        c.batch = 1;
+        for( c.counter = 0; c.counter <= 1; ++c.counter ) {
+            for( c.decrypt = 0; c.decrypt <= 1; ++c.decrypt ) {
+                for( b = 0; b < chunks.count; ++b ) {
+                    for( j = 0; j < workers.count; ++j ) {
+                        c.chunk   = (long)chunks.value[b];
+                        c.workers = (int)workers.value[j];
+                        bench( &c, size, batch_plain, batch_reference, batch_output );
+                    }
+                }
+            }
+        }
+        clean_up_batch( );
+    }
+    return EXIT_SUCCESS;
+}
@@ -6,7 +6,57 @@ PROGRAMMER    : (C) Copyright 2008 by Peter C. Chapin
 
 This program allows the user to encrypt or decryption a file using the
 Blowfish algorithm. It is multithreaded and attempts to overlap the
-file I/O operations with the encryption operation.
+file I/O operations with the encryption operation. The threads are
+organized as a pipeline (see pipeline.h): the main thread reads, one
+stage encrypts or decrypts and a final stage writes.
+
+Encryption in CFB mode is inherently sequential so only one thread ever
+encrypts. Decryption, however, only needs the previous ciphertext block to
+decrypt each block. The reader thus tags every chunk with its offset in the
+stream and the ciphertext bytes that precede it, allowing the -j option to
+spread decryption over several worker threads. The writer stage is ordered,
+so the pipeline puts the chunks back in order before they are written.
+Decryption and counter mode use the multi-block engine in bf_engine.h,
+which encrypts several independent blocks at once.
+
+The -q option sets how many chunks each buffer between the stages can
+hold. Deeper queues let the pipeline ride out longer I/O stalls.
+
+With -c the file uses the counter mode container format (see bfctr.h). In
+that mode every chunk is independent in both directions, so -j applies to
+encryption as well.
+
+Chunks come from a fixed pool that is set up before the pipeline starts.
+The reader takes chunks from the pool's free list and the writer gives
+them back, so no memory is allocated while the file is processed and the
+amount of data in flight is bounded. The data buffers are page aligned.
+With -v the program reports how often the reader had to wait for a chunk.
+
+Chunks hold 4096 bytes unless -b gives another size, from 4K to 16M, or
+"auto" to pick one from the input file (see bfio.h). The writer gathers
+fewer large chunks into each write, and the pool shrinks accordingly, but
+big chunks with a deep queue still add up to a lot of memory.
+
+With -u the reader and writer use io_uring (see uring.h) to keep up to
+the given number of reads and writes queued on regular files, instead of
+waiting for each read() or write() in turn. The depth can be from 0 to
+4096; 0, the default, turns io_uring off. The chunk pool's buffers are
+registered with the kernel when RLIMIT_MEMLOCK allows. Writes go straight
+to each chunk's place in the output file, so a file opened for appending
+is left to write(); and since a descriptor inherited as - shares its file
+position with the shell, that position is moved past the data at the end,
+as read() and write() would have left it. When io_uring is not available
+the program quietly uses ordinary system calls (-v says so).
+
+Either file name can be - for standard input or output, so the program
+can sit in the middle of a shell pipeline. The reader keeps reading until
+each chunk is full, however little a pipe hands over at a time, and the
+pipe buffers are enlarged to hold a few chunks where the system allows.
+Every byte must pass through the cipher, so it is read into a chunk and
+written out once; splice() can't avoid that. Nor is vmsplice() used for
+the output: the pipe would keep referring to the pool's pages after the
+chunk was recycled and overwritten. With -v the messages go to standard
+error when the output is standard output.
 
 To Do:
 
@@ -24,6 +74,7 @@ Please send comments or bug reports to
 ****************************************************************************/
 
 // Standard
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -33,144 +84,602 @@ Please send comments or bug reports to
 #include <unistd.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 
 #include <pthread.h>
-#include "pcbuffer.h"
+#include "bounded_buffer.h"
+#include "pipeline.h"
 
 // OpenSSL
 #include <openssl/blowfish.h>
 
-#define BUFFER_SIZE 4096
+#include "bf_engine.h"
+#include "bfctr.h"
+#include "bfio.h"
+#include "uring.h"
+
+#define HISTORY_SIZE 16            // Ciphertext bytes a decryptor needs before a chunk.
+#define WRITE_BATCH  16            // Most chunks the writer takes or writes at once ...
+#define WRITE_BYTES  (1024 * 1024) // ... unless that would be more bytes than this.
+#define URING_LIMIT  4096          // Largest io_uring queue depth allowed.
+#define PIPE_CHUNKS  4             // Chunks a pipe should be able to hold.
 
 extern int optind;
+extern char *optarg;
 
 // This should be passed as an argument to the encryptor thread. I'm
 // making it global because I'm too lazy to set up a structure, etc.
 //
 unsigned char raw_key[16];
+BF_KEY key;
 
 // This should also be passed as an argument to the threads (all
 // threads). My laziness knows no bounds!
 //
 int do_verbose = 0;
 
+// Where -v sends its messages. Not stdout if that is where the output goes.
+FILE *report;
+
+// Number of threads in the encryption/decryption stage. Only CFB
+// encryption is limited to one.
+//
+int worker_count = 1;
+
+// Number of chunks each producer/consumer buffer can hold.
+int queue_depth = PCBUFFER_SIZE;
+
+// Bytes in each chunk, and the number of chunks the writer gathers up.
+long chunk_size  = BFIO_DEFAULT_SIZE;
+int  write_batch = WRITE_BATCH;
+
+// Number of reads and writes io_uring keeps queued, or zero for none.
+int uring_depth = 0;
+
+// Set when the counter mode container format is used.
+int do_counter = 0;
+bfctr_header_t header;
+
+// Stage functions print their own error messages and then return this.
+#define REPORTED_ERROR -1
+
 // Used to hold information about a chunk of data from the file.
 struct file_chunk {
-  unsigned char buffer[BUFFER_SIZE];
+  pipeline_item_t link;               // Must be first. The ID is link.sequence + 1.
+  unsigned char *buffer;              // chunk_size bytes in the pool's data area.
   int count;
-  int ID;
+  off_t offset;                       // Stream position of buffer[0].
+  unsigned char prior[HISTORY_SIZE];  // Stream bytes just before offset.
+  int done;                           // Set when an io_uring read finishes.
+  struct file_chunk *next;            // The next io_uring read queued.
+};
+
+struct reader_state {
+  int in;
+  off_t offset;
+  long chunks;                          // Chunks read so far.
+  unsigned char history[HISTORY_SIZE];  // Last bytes read (zero at start).
+  uring_t *ring;                        // NULL to use read().
+  off_t base;                           // File position of stream offset zero.
+  off_t size;                           // Stream bytes in the file.
+  off_t requested;                      // Stream bytes asked of io_uring so far.
+  int outstanding;                      // Chunks on the list below.
+  struct file_chunk *oldest;            // Chunks being read, in stream order.
+  struct file_chunk *newest;
+};
+
+struct encryptor_state {
+  unsigned char IV[8];
+  int IV_index;
+  int direction;
+};
+
+struct writer_state {
+  int out;
+  int ready;                            // Chunks waiting to be written.
+  long total;                           // Chunks written so far.
+  struct iovec vector[WRITE_BATCH];
+  struct file_chunk *held[WRITE_BATCH];
+  uring_t *ring;                        // NULL to use write().
+  off_t base;                           // File position of stream offset zero.
+  off_t written;                        // Stream bytes io_uring has written.
+  int error;                            // First io_uring write error (an errno value).
 };
 
-pcbuffer incoming;
-pcbuffer outgoing;
 
-void *reader_thread(void *arg)
+// All the chunks there are.
+struct chunk_pool {
+  struct file_chunk *chunks;
+  unsigned char *data;                  // Aligned for the files; one buffer per chunk.
+  size_t size;                          // Bytes in data.
+  bounded_buffer_t free_list;
+  long exhausted;                       // Times the reader had to wait.
+} pool;
+
+#define ID_OF(chunk) ((chunk)->link.sequence + 1)
+
+
+int pool_init(int count, size_t alignment)
+{
+  int i;
+
+  pool.exhausted = 0;
+  pool.chunks = malloc(count * sizeof(struct file_chunk));
+  pool.size   = (size_t)count * chunk_size;
+  pool.data   = bfio_alloc(pool.size, alignment);
+  if (pool.chunks == NULL || pool.data == NULL ||
+      bounded_buffer_init(&pool.free_list, count) == -1) {
+    free(pool.chunks);
+    free(pool.data);
+    return -1;
+  }
+  for (i = 0; i < count; i++) {
+    pool.chunks[i].buffer = pool.data + (size_t)i * chunk_size;
+    bounded_buffer_push(&pool.free_list, &pool.chunks[i]);
+  }
+  return 0;
+}
+
+
+void pool_destroy(void)
+{
+  bounded_buffer_destroy(&pool.free_list);
+  free(pool.data);
+  free(pool.chunks);
+}
+
+
+void discard_chunk(pipeline_item_t *item, void *arg)
+{
+  (void)arg;
+  bounded_buffer_push(&pool.free_list, item);
+}
+
+
+// Finish off a transfer that io_uring only partly did, using ordinary
+// system calls. Returns the number of bytes left undone (reads stop at the
+// end of the file) or -1 with errno set.
+//
+int finish_transfer(int fd, int writing, unsigned char *buffer, int count, off_t position)
+{
+  ssize_t result;
+
+  while (count > 0) {
+    if (writing) result = pwrite(fd, buffer, count, position);
+    else         result = pread(fd, buffer, count, position);
+    if (result == -1) return -1;
+    if (result == 0) break;
+    buffer   += result;
+    count    -= result;
+    position += result;
+  }
+  return count;
+}
+
+
+// Record the result of an io_uring read in its chunk.
+void read_done(struct reader_state *reader, struct file_chunk *chunk, int result)
+{
+  int left;
+
+  if (result > 0 && result < chunk->count) {
+    left = finish_transfer(reader->in, 0, chunk->buffer + result,
+                           chunk->count - result, reader->base + chunk->offset + result);
+    result = (left == -1) ? -errno : chunk->count - left;
+  }
+  chunk->count = result;
+  chunk->done  = 1;
+}
+
+
+// Wait for every io_uring read and return the chunks to the pool.
+void drain_reads(struct reader_state *reader)
+{
+  struct file_chunk *chunk;
+  void *tag;
+  int result;
+
+  while (reader->ring->queued + reader->ring->in_flight > 0) {
+    result = uring_wait(reader->ring, &tag);
+    if (tag == NULL) break;
+    read_done(reader, tag, result);
+  }
+  while ((chunk = reader->oldest) != NULL) {
+    reader->oldest = chunk->next;
+    bounded_buffer_push(&pool.free_list, chunk);
+  }
+  reader->newest      = NULL;
+  reader->outstanding = 0;
+}
+
+
+// Queue reads for the chunks that follow those already on the way.
+void queue_reads(struct reader_state *reader)
+{
+  struct file_chunk *chunk;
+
+  while (reader->outstanding < uring_depth && reader->requested < reader->size) {
+    // Only the reader takes from the pool, so exhaustion means the rest of
+    // the pipeline is behind. There's no need to wait while reads are queued.
+    //
+    if (bounded_buffer_try_pop(&pool.free_list, (void **)&chunk) != 0) {
+      if (reader->outstanding > 0) break;
+      pool.exhausted++;
+      chunk = bounded_buffer_pop(&pool.free_list);
+    }
+    chunk->offset = reader->requested;
+    chunk->count  = chunk_size;
+    if (chunk->count > reader->size - reader->requested) {
+      chunk->count = reader->size - reader->requested;
+    }
+    chunk->done = 0;
+    chunk->next = NULL;
+    uring_read(reader->ring, reader->in,
+               chunk->buffer, chunk->count, reader->base + chunk->offset, chunk);
+    if (reader->newest == NULL) reader->oldest = chunk;
+    else reader->newest->next = chunk;
+    reader->newest = chunk;
+    reader->outstanding++;
+    reader->requested += chunk->count;
+  }
+  uring_submit(reader->ring);
+}
+
+
+// Get the next chunk in the stream from io_uring. Returns NULL at the end
+// of the file or on error, with *status set accordingly.
+//
+struct file_chunk *take_read(struct reader_state *reader, int *status)
+{
+  struct file_chunk *current;
+  void *tag;
+  int result;
+
+  *status = 0;
+  queue_reads(reader);
+  if ((current = reader->oldest) == NULL) return NULL;
+  while (!current->done) {
+    if ((result = uring_wait(reader->ring, &tag)) < 0 && tag == NULL) {
+      current->count = result;
+      break;
+    }
+    read_done(reader, tag, result);
+  }
+  if (current->count <= 0) {
+    // An error, or the file shrank. Either way the stream is over.
+    if (current->count < 0) {
+      fprintf(stderr, "Error reading input: %s\n", strerror(-current->count));
+      *status = REPORTED_ERROR;
+    }
+    drain_reads(reader);
+    return NULL;
+  }
+  reader->oldest = current->next;
+  if (reader->oldest == NULL) reader->newest = NULL;
+  reader->outstanding--;
+  return current;
+}
+
+
+// The pipeline's source. Runs in the main thread.
+int read_chunk(pipeline_item_t **item, void *arg)
 {
-  int *in = (int *)arg;
-  int  counter = 1;
+  struct reader_state *reader = (struct reader_state *)arg;
   struct file_chunk *current;
+  int status;
 
-  current = malloc(sizeof(struct file_chunk));
-  current->ID = counter++;
-  while ((current->count = read(*in, current->buffer, BUFFER_SIZE)) > 0) {
-    if (do_verbose) {
-      printf("Pushing incoming chunk of size %4d (ID=%04d)\n",
-              current->count, current->ID);
+  *item = NULL;
+  if (reader->ring != NULL) {
+    if ((current = take_read(reader, &status)) == NULL) return status;
+  }
+  else {
+    // Only the reader takes from the pool, so exhaustion means the rest of
+    // the pipeline is behind.
+    //
+    if (bounded_buffer_try_pop(&pool.free_list, (void **)&current) != 0) {
+      pool.exhausted++;
+      current = bounded_buffer_pop(&pool.free_list);
+    }
+    current->offset = reader->offset;
+
+    // Fill the chunk even if the input is a pipe that dribbles data in.
+    if ((current->count = bfio_read_full(reader->in, current->buffer, chunk_size)) <= 0) {
+      if (current->count < 0) perror("Error reading input");
+      status = (current->count < 0) ? REPORTED_ERROR : 0;
+      bounded_buffer_push(&pool.free_list, current);
+      return status;
     }
-    pcbuffer_push(&incoming, current);
+  }
+  memcpy(current->prior, reader->history, HISTORY_SIZE);
 
-    // Get next chunk structure ready.
-    current = malloc(sizeof(struct file_chunk));
-    current->ID = counter++;
+  // Slide the history window forward over the data just read.
+  if (current->count >= HISTORY_SIZE) {
+    memcpy(reader->history,
+           current->buffer + current->count - HISTORY_SIZE, HISTORY_SIZE);
+  }
+  else {
+    memmove(reader->history,
+            reader->history + current->count, HISTORY_SIZE - current->count);
+    memcpy(reader->history + HISTORY_SIZE - current->count,
+           current->buffer, current->count);
   }
+  reader->offset += current->count;
+  reader->chunks++;
 
-  // Add the zero sized chunk to mark end-of-file.
   if (do_verbose) {
-    printf("Pushing incoming chunk of size %4d (ID=%04d)\n",
-            current->count, current->ID);
+    fprintf(report, "Pushing incoming chunk of size %4d (ID=%04ld)\n",
+            current->count, reader->chunks);
   }
-  pcbuffer_push(&incoming, current);
+  *item = &current->link;
+  return 0;
+}
+
+
+// The CFB encryption stage. It is ordered so the chunks arrive in sequence.
+int encrypt_chunk(pipeline_item_t *item, void *arg)
+{
+  struct encryptor_state *state = (struct encryptor_state *)arg;
+  struct file_chunk *current = (struct file_chunk *)item;
+
+  // Do the deed.
+  BF_cfb64_encrypt(current->buffer,
+                   current->buffer,
+                   current->count,
+                   &key,
+                   state->IV,
+                   &state->IV_index,
+                   state->direction);
 
-  return NULL;
+  if (do_verbose) {
+    fprintf(report, "Pushing outgoing chunk of size %4d (ID=%04ld)\n",
+            current->count, ID_OF(current));
+  }
+  return 0;
 }
 
 
-void *encryptor_thread(void *arg)
+// Several threads may run this stage at once. In counter mode each chunk
+// is processed using just its offset. In CFB mode each chunk is decrypted
+// on its own by rebuilding the cipher state at the start of the chunk from
+// the ciphertext that precedes it.
+//
+int crypt_chunk(pipeline_item_t *item, void *arg)
 {
-  BF_KEY        key;
   unsigned char IV[8];
+  unsigned char scratch[8];
   int           IV_index;
-  int           direction = *(int *)arg;
-  struct file_chunk *current;
+  int           partial;
+  struct file_chunk *current = (struct file_chunk *)item;
+
+  (void)arg;
+  if (do_counter) {
+    bfctr_crypt(&key,
+                header.nonce,
+                current->offset,
+                current->buffer,
+                current->buffer,
+                current->count);
+  }
+  else {
+    // The IV for a block is the previous ciphertext block (zero for the
+    // first block). If the chunk starts part way into a block, run the
+    // leading bytes of that block through the cipher to catch up.
+    //
+    partial = current->offset % 8;
+    if (current->offset - partial == 0) {
+      memset(IV, 0, 8);
+    }
+    else {
+      memcpy(IV, current->prior + HISTORY_SIZE - partial - 8, 8);
+    }
+    IV_index = 0;
+    BF_cfb64_encrypt(current->prior + HISTORY_SIZE - partial,
+                     scratch,
+                     partial,
+                     &key,
+                     IV,
+                     &IV_index,
+                     BF_DECRYPT);
+
+    // Do the deed. The blocks are independent from here on, so the
+    // multi-block engine can do several at once.
+    //
+    bf_engine_cfb64_decrypt(&key,
+                            current->buffer,
+                            current->buffer,
+                            current->count,
+                            IV,
+                            &IV_index);
+  }
 
-  // Prepare the key.
-  BF_set_key(&key, 16, raw_key);
+  if (do_verbose) {
+    fprintf(report, "Pushing outgoing chunk of size %4d (ID=%04ld)\n",
+            current->count, ID_OF(current));
+  }
+  return 0;
+}
 
-  // Prepare the IV.
-  memset(IV, 0, 8);
-  IV_index = 0;
 
-  current = pcbuffer_pop(&incoming);
-  while (current->count != 0) {
+// Write out a vector of buffers, coping with partial writes.
+int write_vector(int out, struct iovec *vector, int count)
+{
+  ssize_t written;
 
-    // Do the deed.
-    BF_cfb64_encrypt(current->buffer,
-                     current->buffer,
-                     current->count,
-                     &key,
-                     IV,
-                     &IV_index,
-                     direction);
+  while (count > 0) {
+    if ((written = writev(out, vector, count)) == -1) return -1;
 
-    if (do_verbose) {
-      printf("Pushing outgoing chunk of size %4d (ID=%04d)\n",
-              current->count, current->ID);
+    // Skip over whatever made it out.
+    while (count > 0 && (size_t)written >= vector->iov_len) {
+      written -= vector->iov_len;
+      vector++;
+      count--;
+    }
+    if (count > 0) {
+      vector->iov_base = (char *)vector->iov_base + written;
+      vector->iov_len -= written;
     }
-    pcbuffer_push(&outgoing, current);
-
-    // Get next chunk.
-    current = pcbuffer_pop(&incoming);
   }
+  return 0;
+}
 
-  // Send the zero sized chunk on to the next stage.
-  if (do_verbose) {
-    printf("Pushing outgoing chunk of size %4d (ID=%04d)\n",
-            current->count, current->ID);
+
+// Deal with the result of an io_uring write and give its chunk back.
+void write_done(struct writer_state *writer, struct file_chunk *chunk, int result)
+{
+  int left;
+
+  if (result >= 0 && result < chunk->count) {
+    left = finish_transfer(writer->out, 1, chunk->buffer + result,
+                           chunk->count - result, writer->base + chunk->offset + result);
+    result = (left == -1) ? -errno : (left > 0) ? -EIO : chunk->count;
+  }
+  if (result < 0) {
+    if (writer->error == 0) {
+      fprintf(stderr, "Error writing output: %s\n", strerror(-result));
+      writer->error = -result;
+    }
+  }
+  else {
+    writer->written += chunk->count;
+    if (do_verbose) {
+      fprintf(report, "Wrote outgoing chunk of size %4d to disk (ID=%04ld)\n",
+              chunk->count, ID_OF(chunk));
+    }
   }
-  pcbuffer_push(&outgoing, current);
+  writer->total++;
+  bounded_buffer_push(&pool.free_list, chunk);
+}
+
 
-  return NULL;
+// Collect finished io_uring writes: at least one if wait is set, otherwise
+// just those already done. Returns -1 if the ring itself fails.
+//
+int reap_writes(struct writer_state *writer, int wait)
+{
+  void *tag;
+  int result;
+
+  while (wait || uring_ready(writer->ring)) {
+    if ((result = uring_wait(writer->ring, &tag)) < 0 && tag == NULL) {
+      if (writer->error == 0) {
+        fprintf(stderr, "Error writing output: %s\n", strerror(-result));
+        writer->error = -result;
+      }
+      return -1;
+    }
+    write_done(writer, tag, result);
+    wait = 0;
+  }
+  return 0;
 }
 
 
-void *writer_thread(void *arg)
+// Wait for the io_uring writes still in flight. Returns 0 or REPORTED_ERROR.
+int finish_writes(struct writer_state *writer)
 {
-  int *out = (int *)arg;
-  struct file_chunk *current;
+  while (writer->ring->queued + writer->ring->in_flight > 0) {
+    if (reap_writes(writer, 1) == -1) break;
+  }
+  return (writer->error == 0) ? 0 : REPORTED_ERROR;
+}
 
-  current = pcbuffer_pop(&outgoing);
-  while (current->count != 0) {
-    write(*out, current->buffer, current->count);
-    if (do_verbose) {
-      printf("Wrote outgoing chunk of size %4d to disk (ID=%04d)\n",
-              current->count, current->ID);
+
+// Write the chunks gathered by write_chunk, several per system call. The
+// pipeline calls this whenever the writer has handled what was waiting.
+// With io_uring the writes are already queued; they only need submitting.
+//
+int flush_chunks(void *arg)
+{
+  struct writer_state *writer = (struct writer_state *)arg;
+  int status = 0;
+  int i;
+
+  if (writer->ring != NULL) {
+    if (uring_submit(writer->ring) == -1 && writer->error == 0) {
+      perror("Error writing output");
+      writer->error = errno;
     }
+    reap_writes(writer, 0);
+    return (writer->error == 0) ? 0 : REPORTED_ERROR;
+  }
+  if (writer->ready == 0) return 0;
+  if (write_vector(writer->out, writer->vector, writer->ready) == -1) {
+    perror("Error writing output");
+    status = REPORTED_ERROR;
+  }
+  for (i = 0; do_verbose && status == 0 && i < writer->ready; i++) {
+    fprintf(report, "Wrote outgoing chunk of size %4d to disk (ID=%04ld)\n",
+            writer->held[i]->count, ID_OF(writer->held[i]));
+  }
+  bounded_buffer_push_many(&pool.free_list, (void **)writer->held, writer->ready);
+  writer->total += writer->ready;
+  writer->ready  = 0;
+  return status;
+}
 
-    free(current);
 
-    // Get next chunk.
-    current = pcbuffer_pop(&outgoing);
+// The writing stage is ordered, so chunks arrive here in sequence.
+int write_chunk(pipeline_item_t *item, void *arg)
+{
+  struct writer_state *writer = (struct writer_state *)arg;
+  struct file_chunk *current = (struct file_chunk *)item;
+
+  // Queue the chunk for writing at its place in the file, first waiting
+  // for room. The pool only allows for uring_depth chunks being written,
+  // and the kernel may have made the ring bigger than that; holding more
+  // could starve the reader.
+  //
+  while (writer->ring != NULL) {
+    if (writer->error != 0) return REPORTED_ERROR;
+    if (writer->ring->queued + writer->ring->in_flight < (unsigned)uring_depth &&
+        uring_write(writer->ring, writer->out, current->buffer, current->count,
+                    writer->base + current->offset, current) == 0) return 0;
+    reap_writes(writer, 1);
   }
 
-  if (do_verbose) {
-    printf("Writer terminated on chunk of size %4d (ID=%04d)\n",
-            current->count, current->ID);
+  writer->held[writer->ready] = current;
+  writer->vector[writer->ready].iov_base = current->buffer;
+  writer->vector[writer->ready].iov_len  = current->count;
+  writer->ready++;
+  if (writer->ready == write_batch) return flush_chunks(writer);
+  return 0;
+}
+
+
+// Set up a ring for fd if it is a regular file and io_uring can be had.
+// Returns the ring or NULL to use ordinary system calls. Appending ignores
+// the offsets io_uring writes at, so the chunks could land out of order.
+//
+uring_t *start_uring(uring_t *ring, int fd, const char *name)
+{
+  struct stat info;
+  int flags;
+
+  if (fstat(fd, &info) == -1 || !S_ISREG(info.st_mode)) return NULL;
+  if ((flags = fcntl(fd, F_GETFL)) == -1 || (flags & O_APPEND)) return NULL;
+  if (uring_init(ring, uring_depth) == -1) {
+    if (do_verbose) {
+      fprintf(report, "Using %s() for the %s; io_uring is unavailable (%s)\n",
+              strcmp(name, "input") == 0 ? "read" : "write", name, strerror(errno));
+    }
+    return NULL;
   }
+  return ring;
+}
 
-  // Release the end-of-file marker chunk.
-  free(current);
 
-  return NULL;
+// Register the chunk pool with a ring, or note why not. It works either way.
+void register_pool(uring_t *ring, const char *name)
+{
+  if (uring_register_buffer(ring, pool.data, pool.size) == -1) {
+    if (do_verbose) {
+      fprintf(report, "Unable to register the chunk pool for the %s (%s)\n",
+              name, strerror(errno));
+    }
+  }
+  else if (do_verbose) {
+    fprintf(report, "Keeping up to %d requests queued for the %s\n", uring_depth, name);
+  }
 }
 
 
@@ -183,22 +692,43 @@ int main(int argc, char **argv)
   int  option;
   int  do_encrypt = 0;
   int  do_decrypt = 0;
-  int  direction;
   int  in;            // Input file handle.
   int  out;           // Output file handle.
-  pthread_t     reader_ID, encryptor_ID, writer_ID;
-  
-  while ((option = getopt(argc, argv, "edv")) != -1) {
+  int  error;
+  size_t alignment;
+  int    pool_count;
+  struct stat info;
+  uring_t in_ring;
+  uring_t out_ring;
+  pipeline_t pipeline;
+  struct reader_state    reader;
+  struct encryptor_state encryptor;
+  struct writer_state    writer;
+
+  while ((option = getopt(argc, argv, "edcvj:q:b:u:")) != -1) {
     switch (option) {
-      case 'e': do_encrypt = 1; direction = BF_ENCRYPT; break;
-      case 'd': do_decrypt = 1; direction = BF_DECRYPT; break;
+      case 'e': do_encrypt = 1; break;
+      case 'd': do_decrypt = 1; break;
+      case 'c': do_counter = 1; break;
       case 'v': do_verbose = 1; break;
+      case 'j': worker_count = atoi(optarg); break;
+      case 'q': queue_depth  = atoi(optarg); break;
+      case 'u': uring_depth  = atoi(optarg); break;
+      case 'b':
+        if ((chunk_size = bfio_parse_size(optarg)) == -1) {
+          fprintf(stderr, "The chunk size must be from 4K to 16M, or auto.\n");
+          return 1;
+        }
+        break;
     }
   }
 
   if (argc - optind != 3) {
     fprintf(stderr,
-      "Usage: %s -e|-d [-v] infile outfile \"pass phrase\"\n", argv[0]);
+      "Usage: %s -e|-d [-c] [-v] [-j workers] [-q depth] [-b size|auto] [-u depth] "
+      "infile|- outfile|- \"pass phrase\"\n"
+      "The io_uring depth (-u) is from 0 to %d; 0 turns io_uring off.\n",
+      argv[0], URING_LIMIT);
     return 1;
   }
 
@@ -208,39 +738,177 @@ int main(int argc, char **argv)
     return 1;
   }
 
+  if (worker_count < 1) {
+    fprintf(stderr, "The number of workers must be at least one.\n");
+    return 1;
+  }
+
+  if (queue_depth < 1) {
+    fprintf(stderr, "The queue depth must be at least one.\n");
+    return 1;
+  }
+
+  if (uring_depth < 0 || uring_depth > URING_LIMIT) {
+    fprintf(stderr, "The io_uring depth must be from 0 to %d (0 turns io_uring off).\n",
+            URING_LIMIT);
+    return 1;
+  }
+
+#ifdef PCBUFFER_SPSC
+  // The lock free buffers only allow one thread on each end.
+  if (worker_count > 1) {
+    fprintf(stderr, "This build uses single producer/consumer buffers; "
+                    "-j is not available.\n");
+    return 1;
+  }
+#endif
+
+  // CFB encryption depends on the previous output block; it can't be split.
+  if (do_encrypt && !do_counter) worker_count = 1;
+
   // Prepare the key.
-  strncpy(raw_key, argv[optind + 2], 16);
+  strncpy((char *)raw_key, argv[optind + 2], 16);
 
-  // Open the files.
-  if ((in = open(argv[optind + 0], O_RDONLY)) == -1) {
+  // Open the files. A name of - means standard input or output.
+  if (strcmp(argv[optind + 0], "-") == 0) {
+    in = STDIN_FILENO;
+  }
+  else if ((in = open(argv[optind + 0], O_RDONLY)) == -1) {
     perror("Error opening input file");
     return 1;
   }
-  if ((out = open(argv[optind + 1], O_WRONLY|O_CREAT|O_TRUNC, 0666)) == -1) {
+  report = stdout;
+  if (strcmp(argv[optind + 1], "-") == 0) {
+    out    = STDOUT_FILENO;
+    report = stderr;
+  }
+  else if ((out = open(argv[optind + 1], O_WRONLY|O_CREAT|O_TRUNC, 0666)) == -1) {
     perror("Error opening output file");
     close(in);
     return 1;
   }
 
-  // Initialize the producer/consumer buffers.  
-  pcbuffer_init(&incoming);
-  pcbuffer_init(&outgoing);
+  // Pipes hand over data in pieces no bigger than their buffers, so let
+  // them hold a few chunks.
+  //
+  if (chunk_size == BFIO_AUTO) chunk_size = bfio_auto_size(in);
+  bfio_grow_pipe(in, PIPE_CHUNKS * chunk_size);
+  bfio_grow_pipe(out, PIPE_CHUNKS * chunk_size);
+
+  // Deal with the counter mode header before the pipeline starts.
+  if (do_counter) {
+    if (do_encrypt) {
+      if (bfctr_new_header(&header, chunk_size) == -1 ||
+          bfctr_write_header(out, &header) == -1) {
+        fprintf(stderr, "Error writing counter mode header.\n");
+        close(in);
+        close(out);
+        return 1;
+      }
+    }
+    else if (bfctr_read_header(in, &header) == -1) {
+      fprintf(stderr, "Input is not a counter mode file.\n");
+      close(in);
+      close(out);
+      return 1;
+    }
+  }
+
+  // The positions the streams start from, past any counter mode header.
+  reader.ring = writer.ring = NULL;
+  if (uring_depth > 0) {
+    if ((reader.ring = start_uring(&in_ring, in, "input")) != NULL) {
+      fstat(in, &info);
+      reader.base = lseek(in, 0, SEEK_CUR);
+      reader.size = (info.st_size > reader.base) ? info.st_size - reader.base : 0;
+    }
+    if ((writer.ring = start_uring(&out_ring, out, "output")) != NULL) {
+      writer.base = lseek(out, 0, SEEK_CUR);
+    }
+  }
+
+  // Enough chunks to fill both buffers with some for the workers and the
+  // writer to hold on to, plus those io_uring has. The buffers suit both
+  // files.
+  //
+  if (chunk_size * write_batch > WRITE_BYTES) {
+    write_batch = (chunk_size >= WRITE_BYTES) ? 1 : WRITE_BYTES / chunk_size;
+  }
+  pool_count = 2 * queue_depth + worker_count + write_batch;
+  if (reader.ring != NULL) pool_count += uring_depth;
+  if (writer.ring != NULL) pool_count += uring_depth;
+  alignment = bfio_alignment(in);
+  if (bfio_alignment(out) > alignment) alignment = bfio_alignment(out);
+  if (pool_init(pool_count, alignment) == -1) {
+    fprintf(stderr, "Unable to allocate a pool of %ld byte chunks for a "
+                    "queue depth of %d.\n", chunk_size, queue_depth);
+    if (reader.ring != NULL) uring_destroy(reader.ring);
+    if (writer.ring != NULL) uring_destroy(writer.ring);
+    close(in);
+    close(out);
+    return 1;
+  }
+  if (reader.ring != NULL) register_pool(reader.ring, "input");
+  if (writer.ring != NULL) register_pool(writer.ring, "output");
+
+  // Set up the pipeline. The buffers between the stages are created for us.
+  BF_set_key(&key, 16, raw_key);
+  reader.in     = in;
+  reader.offset = 0;
+  reader.chunks = 0;
+  memset(reader.history, 0, HISTORY_SIZE);
+  reader.requested   = 0;
+  reader.outstanding = 0;
+  reader.oldest = reader.newest = NULL;
+  writer.out    = out;
+  writer.ready  = 0;
+  writer.total  = 0;
+  writer.written = 0;
+  writer.error  = 0;
+  pipeline_init(&pipeline, read_chunk, &reader, discard_chunk, NULL, queue_depth);
+  if (do_encrypt && !do_counter) {
+    memset(encryptor.IV, 0, 8);
+    encryptor.IV_index  = 0;
+    encryptor.direction = BF_ENCRYPT;
+    error = pipeline_add_stage(&pipeline, encrypt_chunk, NULL, &encryptor, 1, 1);
+  }
+  else {
+    error = pipeline_add_stage(&pipeline, crypt_chunk, NULL, NULL, worker_count, 0);
+  }
+  if (error == 0) {
+    error = pipeline_add_stage(&pipeline, write_chunk, flush_chunks, &writer, 1, 1);
+  }
 
-  // Create the threads.
-  pthread_create(&reader_ID, NULL, reader_thread, &in);
-  pthread_create(&encryptor_ID, NULL, encryptor_thread, &direction);
-  pthread_create(&writer_ID, NULL, writer_thread, &out);
+  // Run it to the end.
+  if (error != 0) {
+    fprintf(stderr, "Unable to set up the pipeline: %s\n", strerror(error));
+  }
+  else if ((error = pipeline_run(&pipeline)) > 0) {
+    fprintf(stderr, "Unable to run the pipeline: %s\n", strerror(error));
+  }
 
-  // Wait for them to terminate.
-  pthread_join(reader_ID, NULL);
-  pthread_join(encryptor_ID, NULL);
-  pthread_join(writer_ID, NULL);
+  // Nothing may be left in flight when the pool goes. io_uring never
+  // moved the file positions, which matters when they are shared (-).
+  //
+  if (reader.ring != NULL) {
+    drain_reads(&reader);
+    uring_destroy(reader.ring);
+    lseek(in, reader.base + reader.offset, SEEK_SET);
+  }
+  if (writer.ring != NULL) {
+    if (finish_writes(&writer) != 0 && error == 0) error = REPORTED_ERROR;
+    uring_destroy(writer.ring);
+    lseek(out, writer.base + writer.written, SEEK_SET);
+  }
+  if (do_verbose) {
+    fprintf(report, "Writer terminated after %ld chunks\n", writer.total);
+    fprintf(report, "Reader waited for the chunk pool %ld times\n", pool.exhausted);
+  }
 
   // Clean up.
-  pcbuffer_destroy(&outgoing);
-  pcbuffer_destroy(&incoming);
+  pool_destroy();
   close(in);
   close(out);
-  
-  return 0;
+
+  return (error == 0) ? 0 : 1;
 }
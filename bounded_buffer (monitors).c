@@ -5,16 +5,33 @@ AUTHOR  : (C) Copyright 2010 by Peter C. Chapin <PChapin@vtc.vsc.edu>
 
 ****************************************************************************/
 
+#include <errno.h>
+#include <stdlib.h>
 #include "bounded_buffer.h"
 
-void bounded_buffer_init( bounded_buffer_t *p )
+int bounded_buffer_init( bounded_buffer_t *p, int capacity )
 {
+    pthread_condattr_t attributes;
+
+    // Round the capacity up to a power of two so positions can be wrapped with a mask.
+    p->capacity = 1;
+    while( p->capacity < capacity && p->capacity < BOUNDED_BUFFER_MAX ) p->capacity *= 2;
+    p->mask = p->capacity - 1;
+
+    p->buffer = malloc( p->capacity * sizeof( void * ) );
+    if( p->buffer == NULL ) return -1;
+
+    // Deadlines for the timed operations are measured on the monotonic clock.
+    pthread_condattr_init( &attributes );
+    pthread_condattr_setclock( &attributes, CLOCK_MONOTONIC );
     pthread_mutex_init( &p->lock, NULL );
-    pthread_cond_init( &p->not_full, NULL );
-    pthread_cond_init( &p->not_empty, NULL );
+    pthread_cond_init( &p->not_full, &attributes );
+    pthread_cond_init( &p->not_empty, &attributes );
+    pthread_condattr_destroy( &attributes );
     p->next_in  = 0;
     p->next_out = 0;
     p->count    = 0;
+    return 0;
 }
 
 
@@ -23,19 +40,100 @@ void bounded_buffer_destroy( bounded_buffer_t *p )
     pthread_mutex_destroy( &p->lock );
     pthread_cond_destroy( &p->not_full );
     pthread_cond_destroy( &p->not_empty );
+    free( p->buffer );
 }
 
 
-void bounded_buffer_push( bounded_buffer_t *p, void *incoming )
+// Wait on a condition until the deadline (NULL means forever).
+static int wait( pthread_cond_t *condition, pthread_mutex_t *lock, const struct timespec *deadline )
+{
+    if( deadline == NULL ) return pthread_cond_wait( condition, lock );
+    return pthread_cond_timedwait( condition, lock, deadline );
+}
+
+
+// The following two functions must be called with the lock held.
+static void put( bounded_buffer_t *p, void *incoming )
 {
-    pthread_mutex_lock( &p->lock);
-    while( p->count == BOUNDED_BUFFER_SIZE )
-        pthread_cond_wait( &p->not_full, &p->lock );
     p->buffer[p->next_in] = incoming;
-    p->next_in = (p->next_in + 1) % BOUNDED_BUFFER_SIZE;
+    p->next_in = (p->next_in + 1) & p->mask;
     p->count++;
     pthread_cond_signal( &p->not_empty );
+}
+
+
+static void *take( bounded_buffer_t *p )
+{
+    void *return_value;
+
+    return_value = p->buffer[p->next_out];
+    p->next_out = (p->next_out + 1) & p->mask;
+    p->count--;
+    pthread_cond_signal( &p->not_full );
+
+    return return_value;
+}
+
+
+int bounded_buffer_try_push( bounded_buffer_t *p, void *incoming )
+{
+    pthread_mutex_lock( &p->lock );
+    if( p->count == p->capacity ) {
+        pthread_mutex_unlock( &p->lock );
+        return EAGAIN;
+    }
+    put( p, incoming );
+    pthread_mutex_unlock( &p->lock );
+    return 0;
+}
+
+
+int bounded_buffer_timed_push( bounded_buffer_t *p, void *incoming, const struct timespec *deadline )
+{
+    pthread_mutex_lock( &p->lock);
+    while( p->count == p->capacity ) {
+        if( wait( &p->not_full, &p->lock, deadline ) == ETIMEDOUT && p->count == p->capacity ) {
+            pthread_mutex_unlock( &p->lock );
+            return ETIMEDOUT;
+        }
+    }
+    put( p, incoming );
+    pthread_mutex_unlock( &p->lock );
+    return 0;
+}
+
+
+int bounded_buffer_try_pop( bounded_buffer_t *p, void **outgoing )
+{
+    pthread_mutex_lock( &p->lock );
+    if( p->count == 0 ) {
+        pthread_mutex_unlock( &p->lock );
+        return EAGAIN;
+    }
+    *outgoing = take( p );
     pthread_mutex_unlock( &p->lock );
+    return 0;
+}
+
+
+int bounded_buffer_timed_pop( bounded_buffer_t *p, void **outgoing, const struct timespec *deadline )
+{
+    pthread_mutex_lock( &p->lock );
+    while( p->count == 0 ) {
+        if( wait( &p->not_empty, &p->lock, deadline ) == ETIMEDOUT && p->count == 0 ) {
+            pthread_mutex_unlock( &p->lock );
+            return ETIMEDOUT;
+        }
+    }
+    *outgoing = take( p );
+    pthread_mutex_unlock( &p->lock );
+    return 0;
+}
+
+
+void bounded_buffer_push( bounded_buffer_t *p, void *incoming )
+{
+    bounded_buffer_timed_push( p, incoming, NULL );
 }
 
 
@@ -43,14 +141,48 @@ void *bounded_buffer_pop( bounded_buffer_t *p )
 {
     void *return_value;
 
+    bounded_buffer_timed_pop( p, &return_value, NULL );
+    return return_value;
+}
+
+
+void bounded_buffer_push_many( bounded_buffer_t *p, void **incoming, int count )
+{
+    int pushed;
+
+    pthread_mutex_lock( &p->lock );
+    while( count > 0 ) {
+        while( p->count == p->capacity )
+            pthread_cond_wait( &p->not_full, &p->lock );
+
+        // Move as many items as there is room for, then wake consumers once for the lot.
+        for( pushed = 0; count > 0 && p->count < p->capacity; ++pushed, --count ) {
+            p->buffer[p->next_in] = *incoming++;
+            p->next_in = (p->next_in + 1) & p->mask;
+            p->count++;
+        }
+        if( pushed == 1 ) pthread_cond_signal( &p->not_empty );
+        else pthread_cond_broadcast( &p->not_empty );
+    }
+    pthread_mutex_unlock( &p->lock );
+}
+
+
+int bounded_buffer_pop_many( bounded_buffer_t *p, void **outgoing, int max )
+{
+    int popped;
+
     pthread_mutex_lock( &p->lock );
     while( p->count == 0 )
         pthread_cond_wait( &p->not_empty, &p->lock );
-    return_value = p->buffer[p->next_out];
-    p->next_out = (p->next_out + 1) % BOUNDED_BUFFER_SIZE;
-    p->count--;
-    pthread_cond_signal( &p->not_full );
+    for( popped = 0; popped < max && p->count > 0; ++popped ) {
+        outgoing[popped] = p->buffer[p->next_out];
+        p->next_out = (p->next_out + 1) & p->mask;
+        p->count--;
+    }
+    if( popped == 1 ) pthread_cond_signal( &p->not_full );
+    else pthread_cond_broadcast( &p->not_full );
     pthread_mutex_unlock( &p->lock );
 
-    return return_value;
+    return popped;
 }
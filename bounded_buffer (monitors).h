@@ -8,13 +8,42 @@ AUTHOR  : (C) Copyright 2010 by Peter C. Chapin <PChapin@vtc.vsc.edu>
 #ifndef BOUNDED_BUFFER_H
 #define BOUNDED_BUFFER_H
 
+#ifdef BOUNDED_BUFFER_MPMC
+
+// Compiling with -DBOUNDED_BUFFER_MPMC (and linking mpmc_queue.c instead of bounded_buffer.c)
+// replaces this module with a lock free queue that has the same behavior. Threads park after a
+// bounded spin.
+//
+#include "mpmc_queue.h"
+
+typedef mpmc_queue_t bounded_buffer_t;
+
+#define BOUNDED_BUFFER_SIZE MPMC_QUEUE_SIZE
+
+#define bounded_buffer_init( p, capacity ) mpmc_queue_init( (p), (capacity), MPMC_QUEUE_PARK )
+#define bounded_buffer_destroy   mpmc_queue_destroy
+#define bounded_buffer_push      mpmc_queue_push
+#define bounded_buffer_pop       mpmc_queue_pop
+#define bounded_buffer_push_many mpmc_queue_push_many
+#define bounded_buffer_pop_many  mpmc_queue_pop_many
+#define bounded_buffer_try_push   mpmc_queue_try_push
+#define bounded_buffer_try_pop    mpmc_queue_try_pop
+#define bounded_buffer_timed_push mpmc_queue_timed_push
+#define bounded_buffer_timed_pop  mpmc_queue_timed_pop
+
+#else
+
 #include <pthread.h>
+#include <time.h>
 
-#define BOUNDED_BUFFER_SIZE 8
+#define BOUNDED_BUFFER_SIZE 8          // A reasonable default capacity.
+#define BOUNDED_BUFFER_MAX  (1 << 24)  // Largest capacity allowed.
 
 // This is our bounded buffer type.
 typedef struct {
-    void *buffer[BOUNDED_BUFFER_SIZE];
+    void          **buffer;
+    int             capacity;  // Always a power of two.
+    int             mask;      // capacity - 1
     pthread_mutex_t lock;
     pthread_cond_t  not_full;
     pthread_cond_t  not_empty;
@@ -25,9 +54,27 @@ typedef struct {
     // buffer or a full buffer; that case must be disambiguated.
 } bounded_buffer_t;
 
-void  bounded_buffer_init( bounded_buffer_t * );
+// The capacity is rounded up to a power of two. Returns 0 or -1 if memory runs out.
+int   bounded_buffer_init( bounded_buffer_t *, int capacity );
 void  bounded_buffer_destroy( bounded_buffer_t * );
 void  bounded_buffer_push( bounded_buffer_t *, void * );
 void *bounded_buffer_pop( bounded_buffer_t * );
 
+// Push all count items, taking the lock once for as many as fit at a time.
+void  bounded_buffer_push_many( bounded_buffer_t *, void **, int count );
+
+// Wait for at least one item and then take up to max items. Returns the number taken.
+int   bounded_buffer_pop_many( bounded_buffer_t *, void **, int max );
+
+// These return 0 on success. The try functions return EAGAIN instead of blocking. The timed
+// functions return ETIMEDOUT once the deadline, an absolute CLOCK_MONOTONIC time, has passed.
+// A NULL deadline waits forever.
+//
+int   bounded_buffer_try_push( bounded_buffer_t *, void * );
+int   bounded_buffer_try_pop( bounded_buffer_t *, void ** );
+int   bounded_buffer_timed_push( bounded_buffer_t *, void *, const struct timespec *deadline );
+int   bounded_buffer_timed_pop( bounded_buffer_t *, void **, const struct timespec *deadline );
+
+#endif
+
 #endif
@@ -5,14 +5,26 @@ AUTHOR  : (C) Copyright 2010 by Peter C. Chapin <PChapin@vtc.vsc.edu>
 
 ****************************************************************************/
 
+#define _GNU_SOURCE   // For sem_clockwait.
+
+#include <errno.h>
+#include <stdlib.h>
 #include "pcbuffer.h"
 
-void pcbuffer_init( pcbuffer_t *p )
+int pcbuffer_init( pcbuffer_t *p, int capacity )
 {
+    int size = 1;
+
+    while( size < capacity && size < PCBUFFER_MAX ) size *= 2;
+    p->buffer = malloc( size * sizeof( void * ) );
+    if( p->buffer == NULL ) return -1;
+    p->mask = size - 1;
+
     pthread_mutex_init( &p->lock, NULL );
     sem_init( &p->used, 0, 0 );
-    sem_init( &p->free, 0, PCBUFFER_SIZE );
+    sem_init( &p->free, 0, size );
     p->next_in = p->next_out = 0;
+    return 0;
 }
 
 
@@ -21,32 +33,136 @@ void pcbuffer_destroy( pcbuffer_t *p )
     pthread_mutex_destroy( &p->lock );
     sem_destroy( &p->used );
     sem_destroy( &p->free );
+    free( p->buffer );
 }
 
 
-void pcbuffer_push( pcbuffer_t *p, void *incoming )
+// Wait on a semaphore until the deadline (NULL means forever). Returns 0 or ETIMEDOUT.
+static int acquire( sem_t *s, const struct timespec *deadline )
+{
+    int rc;
+
+    do {
+        if( deadline == NULL ) rc = sem_wait( s );
+        else rc = sem_clockwait( s, CLOCK_MONOTONIC, deadline );
+    } while( rc == -1 && errno == EINTR );
+
+    return ( rc == -1 ) ? errno : 0;
+}
+
+
+// Store an item in the free slot the caller has already claimed.
+static void put( pcbuffer_t *p, void *incoming )
 {
-    sem_wait( &p->free );
     pthread_mutex_lock( &p->lock );
     p->buffer[p->next_in] = incoming;
-    p->next_in++;
-    if( p->next_in >= PCBUFFER_SIZE ) p->next_in = 0;
+    p->next_in = ( p->next_in + 1 ) & p->mask;
     pthread_mutex_unlock( &p->lock );
     sem_post( &p->used );
 }
 
 
-void *pcbuffer_pop( pcbuffer_t *p )
+// Remove the item from the used slot the caller has already claimed.
+static void *take( pcbuffer_t *p )
 {
     void *return_value;
 
-    sem_wait( &p->used );
     pthread_mutex_lock( &p->lock );
     return_value = p->buffer[p->next_out];
-    p->next_out++;
-    if( p->next_out >= PCBUFFER_SIZE ) p->next_out = 0;
+    p->next_out = ( p->next_out + 1 ) & p->mask;
     pthread_mutex_unlock( &p->lock );
     sem_post( &p->free );
 
     return return_value;
 }
+
+
+int pcbuffer_try_push( pcbuffer_t *p, void *incoming )
+{
+    if( sem_trywait( &p->free ) == -1 ) return EAGAIN;
+    put( p, incoming );
+    return 0;
+}
+
+
+int pcbuffer_timed_push( pcbuffer_t *p, void *incoming, const struct timespec *deadline )
+{
+    int rc;
+
+    if( ( rc = acquire( &p->free, deadline ) ) != 0 ) return rc;
+    put( p, incoming );
+    return 0;
+}
+
+
+int pcbuffer_try_pop( pcbuffer_t *p, void **outgoing )
+{
+    if( sem_trywait( &p->used ) == -1 ) return EAGAIN;
+    *outgoing = take( p );
+    return 0;
+}
+
+
+int pcbuffer_timed_pop( pcbuffer_t *p, void **outgoing, const struct timespec *deadline )
+{
+    int rc;
+
+    if( ( rc = acquire( &p->used, deadline ) ) != 0 ) return rc;
+    *outgoing = take( p );
+    return 0;
+}
+
+
+void pcbuffer_push( pcbuffer_t *p, void *incoming )
+{
+    pcbuffer_timed_push( p, incoming, NULL );
+}
+
+
+void *pcbuffer_pop( pcbuffer_t *p )
+{
+    void *return_value;
+
+    pcbuffer_timed_pop( p, &return_value, NULL );
+    return return_value;
+}
+
+
+void pcbuffer_push_many( pcbuffer_t *p, void **incoming, int count )
+{
+    int i, n;
+
+    while( count > 0 ) {
+        // Wait for one free slot and then claim any others without blocking.
+        acquire( &p->free, NULL );
+        for( n = 1; n < count && sem_trywait( &p->free ) == 0; ++n ) ;
+
+        pthread_mutex_lock( &p->lock );
+        for( i = 0; i < n; ++i ) {
+            p->buffer[p->next_in] = *incoming++;
+            p->next_in = ( p->next_in + 1 ) & p->mask;
+        }
+        pthread_mutex_unlock( &p->lock );
+        for( i = 0; i < n; ++i ) sem_post( &p->used );
+        count -= n;
+    }
+}
+
+
+int pcbuffer_pop_many( pcbuffer_t *p, void **outgoing, int max )
+{
+    int i, n;
+
+    acquire( &p->used, NULL );
+    for( n = 1; n < max && sem_trywait( &p->used ) == 0; ++n ) ;
+
+    pthread_mutex_lock( &p->lock );
+    for( i = 0; i < n; ++i ) {
+        outgoing[i] = p->buffer[p->next_out];
+        p->next_out = ( p->next_out + 1 ) & p->mask;
+    }
+    pthread_mutex_unlock( &p->lock );
+    for( i = 0; i < n; ++i ) sem_post( &p->free );
+
+    return n;
+}
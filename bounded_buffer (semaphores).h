@@ -8,14 +8,42 @@ AUTHOR  : (C) Copyright 2010 by Peter C. Chapin <PChapin@vtc.vsc.edu>
 #ifndef PCBUFFER_H
 #define PCBUFFER_H
 
+#ifdef PCBUFFER_SPSC
+
+// Compiling with -DPCBUFFER_SPSC (and linking spsc_ring.c instead of pcbuffer.c) replaces this
+// module with a lock free ring. Programs that use it unchanged must have only one producer and
+// one consumer per buffer.
+//
+#include "spsc_ring.h"
+
+typedef spsc_ring_t pcbuffer_t;
+
+#define PCBUFFER_SIZE SPSC_RING_SIZE
+
+#define pcbuffer_init    spsc_ring_init
+#define pcbuffer_destroy spsc_ring_destroy
+#define pcbuffer_push    spsc_ring_push
+#define pcbuffer_pop     spsc_ring_pop
+#define pcbuffer_push_many spsc_ring_push_many
+#define pcbuffer_pop_many  spsc_ring_pop_many
+#define pcbuffer_try_push   spsc_ring_try_push
+#define pcbuffer_try_pop    spsc_ring_try_pop
+#define pcbuffer_timed_push spsc_ring_timed_push
+#define pcbuffer_timed_pop  spsc_ring_timed_pop
+
+#else
+
 #include <pthread.h>
 #include <semaphore.h>
+#include <time.h>
 
-#define PCBUFFER_SIZE 8
+#define PCBUFFER_SIZE 8          // A reasonable default capacity.
+#define PCBUFFER_MAX  (1 << 24)  // Largest capacity allowed.
 
 // This is our producer/consumer buffer type.
 typedef struct {
-    void *buffer[PCBUFFER_SIZE];
+    void          **buffer;
+    int             mask;      // Capacity (a power of two) minus one.
     pthread_mutex_t lock;
     sem_t           used;      // Use POSIX semaphores here.
     sem_t           free;      // ...
@@ -23,9 +51,27 @@ typedef struct {
     int             next_out;  // Oldest used slot.
 } pcbuffer_t;
 
-void  pcbuffer_init( pcbuffer_t * );
+// The capacity is rounded up to a power of two. Returns 0 or -1 if memory runs out.
+int   pcbuffer_init( pcbuffer_t *, int capacity );
 void  pcbuffer_destroy( pcbuffer_t * );
 void  pcbuffer_push( pcbuffer_t *, void * );
 void *pcbuffer_pop( pcbuffer_t * );
 
+// Push all count items, locking once for as many as there are free slots at a time.
+void  pcbuffer_push_many( pcbuffer_t *, void **, int count );
+
+// Wait for at least one item and then take up to max items. Returns the number taken.
+int   pcbuffer_pop_many( pcbuffer_t *, void **, int max );
+
+// These return 0 on success. The try functions return EAGAIN instead of blocking. The timed
+// functions return ETIMEDOUT once the deadline, an absolute CLOCK_MONOTONIC time, has passed.
+// A NULL deadline waits forever.
+//
+int   pcbuffer_try_push( pcbuffer_t *, void * );
+int   pcbuffer_try_pop( pcbuffer_t *, void ** );
+int   pcbuffer_timed_push( pcbuffer_t *, void *, const struct timespec *deadline );
+int   pcbuffer_timed_pop( pcbuffer_t *, void **, const struct timespec *deadline );
+
+#endif
+
 #endif
@@ -0,0 +1,125 @@
+/****************************************************************************
+FILE          : bounded_buffer_demo.c
+SUBJECT       : Test program to exercise bounded_buffer objects.
+PROGRAMMER    : (C) Copyright 2026 by Peter C. Chapin <pcc482719@gmail.com>
+
+Several producers and several consumers share one buffer. Each producer
+pushes a distinct range of integers; the consumers add up what they pop.
+If nothing was lost or duplicated the totals match at the end. First,
+though, a buffer with a capacity of one is checked in a single thread: a
+second push must not overwrite the item already there.
+
+Compile with -DBOUNDED_BUFFER_MPMC and link with mpmc_queue.c to exercise
+the lock free queue instead of the monitor version.
+****************************************************************************/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <pthread.h>
+#include "bounded_buffer.h"
+
+#define PRODUCER_COUNT 4
+#define CONSUMER_COUNT 4
+#define OBJECT_COUNT   100000   // Per producer.
+
+bounded_buffer_t my_buffer;
+
+void *producer( void *arg )
+{
+    int  base = *(int *)arg * OBJECT_COUNT;
+    int  i;
+    int *p;
+
+    for( i = 1; i <= OBJECT_COUNT; ++i ) {
+        p  = malloc( sizeof( int ) );
+       *p  = base + i;
+        bounded_buffer_push( &my_buffer, p );
+    }
+    return NULL;
+}
+
+
+void *consumer( void *arg )
+{
+    long long *total = (long long *)arg;
+    int        i;
+    int       *p;
+
+    for( i = 1; i <= OBJECT_COUNT; ++i ) {
+        p = bounded_buffer_pop( &my_buffer );
+        *total += *p;
+        free( p );
+    }
+    return NULL;
+}
+
+
+// Push twice and pop twice on a buffer of capacity one, a few times round. The lock free queue
+// rounds the capacity up, so the second push may or may not fit, but it must never replace the
+// first item. Returns 1 if all is well.
+//
+int check_capacity_one( void )
+{
+    bounded_buffer_t small;
+    int   items[2];
+    void *item;
+    int   lap;
+    int   ok = 1;
+
+    if( bounded_buffer_init( &small, 1 ) == -1 ) return 0;
+    for( lap = 0; lap < 4 && ok; ++lap ) {
+        bounded_buffer_push( &small, &items[0] );
+        if( bounded_buffer_try_push( &small, &items[1] ) == 0 ) {
+            ok = ( bounded_buffer_pop( &small ) == &items[0] &&
+                   bounded_buffer_pop( &small ) == &items[1] );
+        }
+        else {
+            ok = ( bounded_buffer_pop( &small ) == &items[0] &&
+                   bounded_buffer_try_pop( &small, &item ) == EAGAIN );
+        }
+    }
+    bounded_buffer_destroy( &small );
+    printf( "Capacity one: %s\n", ok ? "OK" : "FAILED" );
+    return ok;
+}
+
+
+int main( void )
+{
+    pthread_t p_IDs[PRODUCER_COUNT];
+    pthread_t c_IDs[CONSUMER_COUNT];
+    int       numbers[PRODUCER_COUNT];
+    long long totals[CONSUMER_COUNT];
+    long long total    = 0;
+    long long expected = 0;
+    long long n        = (long long)PRODUCER_COUNT * OBJECT_COUNT;
+    int       i;
+
+    if( !check_capacity_one( ) ) return EXIT_FAILURE;
+
+    bounded_buffer_init( &my_buffer, BOUNDED_BUFFER_SIZE );
+    for( i = 0; i < CONSUMER_COUNT; ++i ) {
+        totals[i] = 0;
+        pthread_create( &c_IDs[i], NULL, consumer, &totals[i] );
+    }
+    for( i = 0; i < PRODUCER_COUNT; ++i ) {
+        numbers[i] = i;
+        pthread_create( &p_IDs[i], NULL, producer, &numbers[i] );
+    }
+
+    // Let the threads do their thing.
+
+    for( i = 0; i < PRODUCER_COUNT; ++i ) pthread_join( p_IDs[i], NULL );
+    for( i = 0; i < CONSUMER_COUNT; ++i ) {
+        pthread_join( c_IDs[i], NULL );
+        total += totals[i];
+    }
+    bounded_buffer_destroy( &my_buffer );
+
+    // The producers pushed every integer from 1 to n exactly once.
+    expected = n * ( n + 1 ) / 2;
+    printf( "Total = %lld, expected %lld: %s\n", total, expected, total == expected ? "OK" : "FAILED" );
+    return total == expected ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,18 @@
+/****************************************************************************
+FILE    : cache_line.h
+SUBJECT : Cache line size used to keep shared data apart.
+AUTHOR  : (C) Copyright 2026 by Peter C. Chapin <pcc482719@gmail.com>
+
+Data written by one thread and read by another should not share a cache
+line with data that some other thread writes ("false sharing"). Structures
+that care align such members to CACHE_LINE_SIZE.
+****************************************************************************/
+
+#ifndef CACHE_LINE_H
+#define CACHE_LINE_H
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+#endif
@@ -0,0 +1,80 @@
+/****************************************************************************
+FILE          : dissemination_barrier.c
+SUBJECT       : Implementation of a dissemination barrier.
+PROGRAMMER    : (C) Copyright 2026 by Peter C. Chapin <pcc482719@gmail.com>
+
+****************************************************************************/
+
+#include <sched.h>
+#include <stdlib.h>
+#include "dissemination_barrier.h"
+
+#define SPIN_LIMIT 1000   // Checks between calls to sched_yield.
+
+// Locate the flag of the given thread for the given parity and round.
+#define FLAG( b, thread, parity, round ) \
+    ( &(b)->flags[( (thread) * 2 + (parity) ) * (b)->rounds + (round)].flag )
+
+int dissemination_barrier_init( dissemination_barrier_t *b, int threads )
+{
+    int flag_count;
+    int i;
+
+    if( threads < 1 ) threads = 1;
+    b->threads = threads;
+    for( b->rounds = 0; ( 1 << b->rounds ) < threads; ++b->rounds ) ;
+
+    // Allocate at least one flag so that a single thread barrier still has valid storage.
+    flag_count = threads * 2 * ( b->rounds > 0 ? b->rounds : 1 );
+    b->flags   = aligned_alloc( CACHE_LINE_SIZE, flag_count * sizeof( dissemination_flag_t ) );
+    b->locals  = aligned_alloc( CACHE_LINE_SIZE, threads * sizeof( dissemination_local_t ) );
+    if( b->flags == NULL || b->locals == NULL ) {
+        free( b->flags );
+        free( b->locals );
+        return -1;
+    }
+
+    for( i = 0; i < flag_count; ++i ) atomic_init( &b->flags[i].flag, 0 );
+    for( i = 0; i < threads; ++i ) {
+        b->locals[i].parity = 0;
+        b->locals[i].sense  = 1;
+    }
+    return 0;
+}
+
+
+void dissemination_barrier_destroy( dissemination_barrier_t *b )
+{
+    free( b->flags );
+    free( b->locals );
+}
+
+
+int dissemination_barrier_wait( dissemination_barrier_t *b, int id )
+{
+    dissemination_local_t *local = &b->locals[id];
+    atomic_uint           *mine;
+    int                    partner;
+    int                    round;
+    int                    spins = 0;
+
+    for( round = 0; round < b->rounds; ++round ) {
+        partner = ( id + ( 1 << round ) ) % b->threads;
+        atomic_store_explicit( FLAG( b, partner, local->parity, round ), local->sense,
+                               memory_order_release );
+
+        mine = FLAG( b, id, local->parity, round );
+        while( atomic_load_explicit( mine, memory_order_acquire ) != local->sense ) {
+            if( ++spins == SPIN_LIMIT ) {
+                spins = 0;
+                sched_yield( );
+            }
+        }
+    }
+
+    // Use the other set of flags next time; after both sets have been used, flip the sense.
+    if( local->parity == 1 ) local->sense = !local->sense;
+    local->parity = 1 - local->parity;
+
+    return ( id == 0 ) ? BARRIER_SERIAL_THREAD : 0;
+}
@@ -0,0 +1,52 @@
+/****************************************************************************
+FILE          : dissemination_barrier.h
+SUBJECT       : Interface to a dissemination barrier.
+PROGRAMMER    : (C) Copyright 2026 by Peter C. Chapin <pcc482719@gmail.com>
+
+A dissemination barrier has no shared counter at all. It runs in
+ceil(log2(threads)) rounds. In round r thread i sets a flag belonging to
+thread (i + 2^r) mod threads and then waits for its own flag for that round
+to be set. After the last round every thread has heard, directly or
+indirectly, from every other thread. Each flag is written by one thread and
+read by one thread, and each is on its own cache line.
+
+The flags alternate between two sets (the "parity") on successive uses, and
+the value that means "set" flips every other use (the "sense"). This lets
+the barrier be reused without ever clearing a flag.
+
+Threads must identify themselves with a distinct id from 0 to threads - 1.
+Waiting threads spin, yielding the processor now and then.
+****************************************************************************/
+
+#ifndef DISSEMINATION_BARRIER_H
+#define DISSEMINATION_BARRIER_H
+
+#include <stdatomic.h>
+#include "barrier.h"
+#include "cache_line.h"
+
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) atomic_uint flag;
+} dissemination_flag_t;
+
+// Private to one thread.
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) unsigned parity;
+    unsigned sense;
+} dissemination_local_t;
+
+typedef struct {
+    int                    threads;
+    int                    rounds;
+    dissemination_flag_t  *flags;    // Indexed by [thread][parity][round].
+    dissemination_local_t *locals;   // Indexed by thread.
+} dissemination_barrier_t;
+
+// Returns 0 or -1 if memory runs out.
+int  dissemination_barrier_init( dissemination_barrier_t *b, int threads );
+void dissemination_barrier_destroy( dissemination_barrier_t *b );
+
+// No thread arrives last in this algorithm; BARRIER_SERIAL_THREAD is returned in thread 0.
+int  dissemination_barrier_wait( dissemination_barrier_t *b, int id );
+
+#endif
@@ -0,0 +1,215 @@
+/****************************************************************************
+FILE          : fib_bench.c
+SUBJECT       : Compare the work stealing scheduler with the shared queue pool.
+PROGRAMMER    : (C) Copyright 2026 by Peter C. Chapin <pcc482719@gmail.com>
+
+The benchmark computes fib(n) the slow, recursive way. Below a cutoff the
+recursion runs serially, so the cutoff sets how fine grained the tasks are.
+
+  - serial: one thread, no tasks at all.
+  - thread_pool: the boss walks the top of the recursion tree and submits
+    every subproblem at the cutoff to a thread_pool_t, then adds up the
+    futures. All tasks pass through the one shared queue.
+  - work stealing: each call above the cutoff spawns fib(n-1), computes
+    fib(n-2) itself and syncs, the usual fork/join way.
+
+Both parallel versions run the same leaf tasks. The program also checks
+ws_parallel_for by adding up a large range of integers.
+
+Usage: fib_bench [n [cutoff [threads]]]
+
+Build with:
+  gcc -O2 -pthread -o fib_bench fib_bench.c work_stealing.c ws_deque.c \
+      sema.c thread_pool.c bounded_buffer.c
+****************************************************************************/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "thread_pool.h"
+#include "work_stealing.h"
+
+#define POOL_QUEUE_CAPACITY 1024
+#define SUM_COUNT           100000000L
+#define SUM_GRAIN           10000L
+
+static int cutoff;
+
+
+static double now( void )
+{
+    struct timespec t;
+
+    clock_gettime( CLOCK_MONOTONIC, &t );
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+
+static long fib( int n )
+{
+    return ( n < 2 ) ? n : fib( n - 1 ) + fib( n - 2 );
+}
+
+
+// The thread_pool version.
+
+typedef struct {
+    thread_pool_future_t **futures;
+    long                   count;
+    long                   size;
+} future_list_t;
+
+static void *fib_leaf( void *arg )
+{
+    return (void *)fib( (int)(long)arg );
+}
+
+
+static void submit_leaves( thread_pool_t *pool, future_list_t *list, int n )
+{
+    if( n <= cutoff ) {
+        if( list->count == list->size ) {
+            list->size    = 2 * list->size + 16;
+            list->futures = realloc( list->futures, list->size * sizeof( thread_pool_future_t * ) );
+        }
+        list->futures[list->count++] = thread_pool_submit( pool, fib_leaf, (void *)(long)n );
+        return;
+    }
+    submit_leaves( pool, list, n - 1 );
+    submit_leaves( pool, list, n - 2 );
+}
+
+
+static long pool_fib( int n, int threads, long *task_count )
+{
+    thread_pool_t pool;
+    future_list_t list = { NULL, 0, 0 };
+    void         *result;
+    long          total = 0;
+    long          i;
+
+    if( thread_pool_init( &pool, threads, POOL_QUEUE_CAPACITY ) != 0 ) {
+        fprintf( stderr, "Unable to create the thread pool\n" );
+        exit( EXIT_FAILURE );
+    }
+    submit_leaves( &pool, &list, n );
+    for( i = 0; i < list.count; ++i ) {
+        thread_pool_future_get( list.futures[i], &result );
+        thread_pool_future_release( list.futures[i] );
+        total += (long)result;
+    }
+    thread_pool_shutdown( &pool, THREAD_POOL_GRACEFUL );
+    free( list.futures );
+    *task_count = list.count;
+    return total;
+}
+
+
+// The work stealing version.
+
+static ws_pool_t ws_pool;
+
+typedef struct {
+    int  n;
+    long result;
+} fib_call_t;
+
+static void ws_fib( void *arg )
+{
+    fib_call_t *call = arg;
+    fib_call_t  left;
+    fib_call_t  right;
+    ws_group_t  group;
+
+    if( call->n <= cutoff ) {
+        call->result = fib( call->n );
+        return;
+    }
+    left.n  = call->n - 1;
+    right.n = call->n - 2;
+    ws_group_init( &group );
+    ws_spawn( &ws_pool, &group, ws_fib, &left );
+    ws_fib( &right );
+    ws_sync( &ws_pool, &group );
+    call->result = left.result + right.result;
+}
+
+
+static atomic_long range_total;
+
+static void add_range( long begin, long end, void *arg )
+{
+    long sum = 0;
+    long i;
+
+    (void)arg;
+    for( i = begin; i < end; ++i ) sum += i;
+    atomic_fetch_add_explicit( &range_total, sum, memory_order_relaxed );
+}
+
+
+int main( int argc, char **argv )
+{
+    int        n       = 36;
+    int        threads = (int)sysconf( _SC_NPROCESSORS_ONLN );
+    long       expected;
+    long       result;
+    long       task_count;
+    fib_call_t root;
+    ws_group_t group;
+    double     start;
+    double     serial_time;
+    double     elapsed;
+    int        errors = 0;
+
+    cutoff = 12;
+    if( argc > 1 ) n       = atoi( argv[1] );
+    if( argc > 2 ) cutoff  = atoi( argv[2] );
+    if( argc > 3 ) threads = atoi( argv[3] );
+    if( n < 1 || n > 60 || cutoff < 1 || threads < 1 ) {
+        fprintf( stderr, "Usage: %s [n [cutoff [threads]]]\n", argv[0] );
+        return EXIT_FAILURE;
+    }
+
+    printf( "fib(%d), cutoff %d, %d threads\n", n, cutoff, threads );
+    start = now( );
+    expected = fib( n );
+    serial_time = now( ) - start;
+    printf( "%-14s %10.3f s\n", "serial", serial_time );
+
+    start = now( );
+    result = pool_fib( n, threads, &task_count );
+    elapsed = now( ) - start;
+    printf( "%-14s %10.3f s  speedup %5.2f  (%ld tasks)%s\n",
+            "thread_pool", elapsed, serial_time / elapsed, task_count, ( result == expected ) ? "" : "  WRONG" );
+    if( result != expected ) ++errors;
+
+    if( ws_pool_init( &ws_pool, threads ) != 0 ) {
+        fprintf( stderr, "Unable to create the work stealing pool\n" );
+        return EXIT_FAILURE;
+    }
+    root.n = n;
+    ws_group_init( &group );
+    start = now( );
+    ws_spawn( &ws_pool, &group, ws_fib, &root );
+    ws_sync( &ws_pool, &group );
+    elapsed = now( ) - start;
+    printf( "%-14s %10.3f s  speedup %5.2f%s\n",
+            "work stealing", elapsed, serial_time / elapsed, ( root.result == expected ) ? "" : "  WRONG" );
+    if( root.result != expected ) ++errors;
+
+    start = now( );
+    ws_parallel_for( &ws_pool, 0, SUM_COUNT, SUM_GRAIN, add_range, NULL );
+    elapsed = now( ) - start;
+    printf( "%-14s %10.3f s%s\n",
+            "parallel_for", elapsed, ( range_total == SUM_COUNT * ( SUM_COUNT - 1 ) / 2 ) ? "" : "  WRONG" );
+    if( range_total != SUM_COUNT * ( SUM_COUNT - 1 ) / 2 ) ++errors;
+    ws_pool_shutdown( &ws_pool );
+
+    return ( errors == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,44 @@
+/****************************************************************************
+FILE    : futex.h
+SUBJECT : Thin wrappers around the Linux futex system call.
+AUTHOR  : (C) Copyright 2026 by Peter C. Chapin <pcc482719@gmail.com>
+
+A futex lets a thread sleep until some 32 bit word in memory changes
+without needing a mutex or condition variable. The kernel only gets
+involved when a thread actually has to wait, so the synchronization
+objects that use these functions cost just an atomic operation when
+there is no contention.
+****************************************************************************/
+
+#ifndef FUTEX_H
+#define FUTEX_H
+
+#include <errno.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+// Sleep as long as *address holds expected. The deadline is an absolute CLOCK_MONOTONIC time,
+// or NULL to wait forever. Returns 0 if woken (or the value had already changed) and ETIMEDOUT
+// if the deadline passed. Wakeups can be spurious so callers must check their condition again.
+//
+static inline int futex_wait( atomic_uint *address, unsigned expected, const struct timespec *deadline )
+{
+    if( syscall( SYS_futex, address, FUTEX_WAIT_BITSET | FUTEX_PRIVATE_FLAG,
+                 expected, deadline, NULL, FUTEX_BITSET_MATCH_ANY ) == -1 ) {
+        if( errno == ETIMEDOUT ) return ETIMEDOUT;
+    }
+    return 0;
+}
+
+
+// Wake up to count threads sleeping on address. Use INT_MAX to wake them all.
+static inline void futex_wake( atomic_uint *address, int count )
+{
+    syscall( SYS_futex, address, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, count, NULL, NULL, 0 );
+}
+
+#endif
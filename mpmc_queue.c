@@ -0,0 +1,260 @@
+/****************************************************************************
+FILE    : mpmc_queue.c
+SUBJECT : Implementation of a lock free multi-producer/multi-consumer queue.
+AUTHOR  : (C) Copyright 2026 by Peter C. Chapin <pcc482719@gmail.com>
+
+The algorithm is Dmitry Vyukov's bounded MPMC queue. Slot i starts with
+sequence number i. A producer that claims position pos may fill the slot
+when its sequence equals pos; it then sets the sequence to pos + 1. A
+consumer that claims position pos may empty the slot when its sequence
+equals pos + 1; it then sets the sequence to pos + capacity, which is the
+position the slot will have on the next lap.
+****************************************************************************/
+
+#include <errno.h>
+#include <limits.h>
+#include <sched.h>
+#include <stdlib.h>
+#include "mpmc_queue.h"
+#include "futex.h"
+
+#define SPIN_LIMIT 100   // Failed attempts before parking or yielding.
+
+int mpmc_queue_init( mpmc_queue_t *q, int capacity, mpmc_queue_mode mode )
+{
+    unsigned size = 2;  // With one slot, a full slot looks free to the next push.
+    unsigned i;
+
+    while( (int)size < capacity && size < MPMC_QUEUE_MAX ) size *= 2;
+    q->slots = aligned_alloc( CACHE_LINE_SIZE, size * sizeof( mpmc_slot_t ) );
+    if( q->slots == NULL ) return -1;
+    q->mask = size - 1;
+
+    for( i = 0; i < size; ++i ) {
+        atomic_init( &q->slots[i].sequence, i );
+        q->slots[i].item = NULL;
+    }
+    atomic_init( &q->enqueue_pos, 0 );
+    atomic_init( &q->dequeue_pos, 0 );
+    atomic_init( &q->push_event, 0 );
+    atomic_init( &q->waiting_consumers, 0 );
+    atomic_init( &q->pop_event, 0 );
+    atomic_init( &q->waiting_producers, 0 );
+    q->mode = mode;
+    return 0;
+}
+
+
+void mpmc_queue_destroy( mpmc_queue_t *q )
+{
+    free( q->slots );
+}
+
+
+// Returns 1 if the item was added, 0 if the queue was full.
+static int try_push( mpmc_queue_t *q, void *incoming )
+{
+    mpmc_slot_t *slot;
+    unsigned     sequence;
+    unsigned     pos = atomic_load_explicit( &q->enqueue_pos, memory_order_relaxed );
+    int          difference;
+
+    for( ;; ) {
+        slot       = &q->slots[pos & q->mask];
+        sequence   = atomic_load_explicit( &slot->sequence, memory_order_acquire );
+        difference = (int)( sequence - pos );
+        if( difference == 0 ) {
+            if( atomic_compare_exchange_weak_explicit( &q->enqueue_pos, &pos, pos + 1,
+                                                       memory_order_relaxed, memory_order_relaxed ) )
+                break;
+        }
+        else if( difference < 0 ) {
+            return 0;
+        }
+        else {
+            pos = atomic_load_explicit( &q->enqueue_pos, memory_order_relaxed );
+        }
+    }
+    slot->item = incoming;
+    atomic_store_explicit( &slot->sequence, pos + 1, memory_order_release );
+    return 1;
+}
+
+
+// Returns 1 and stores the item if one was removed, 0 if the queue was empty.
+static int try_pop( mpmc_queue_t *q, void **outgoing )
+{
+    mpmc_slot_t *slot;
+    unsigned     sequence;
+    unsigned     pos = atomic_load_explicit( &q->dequeue_pos, memory_order_relaxed );
+    int          difference;
+
+    for( ;; ) {
+        slot       = &q->slots[pos & q->mask];
+        sequence   = atomic_load_explicit( &slot->sequence, memory_order_acquire );
+        difference = (int)( sequence - ( pos + 1 ) );
+        if( difference == 0 ) {
+            if( atomic_compare_exchange_weak_explicit( &q->dequeue_pos, &pos, pos + 1,
+                                                       memory_order_relaxed, memory_order_relaxed ) )
+                break;
+        }
+        else if( difference < 0 ) {
+            return 0;
+        }
+        else {
+            pos = atomic_load_explicit( &q->dequeue_pos, memory_order_relaxed );
+        }
+    }
+    *outgoing = slot->item;
+    atomic_store_explicit( &slot->sequence, pos + q->mask + 1, memory_order_release );
+    return 1;
+}
+
+
+// Tell any threads parked on the given event that something changed.
+static void signal_event( atomic_uint *event, atomic_uint *waiting )
+{
+    atomic_thread_fence( memory_order_seq_cst );
+    if( atomic_load_explicit( waiting, memory_order_relaxed ) != 0 ) {
+        atomic_fetch_add( event, 1 );
+        futex_wake( event, INT_MAX );
+    }
+}
+
+
+// Has an absolute CLOCK_MONOTONIC deadline gone by?
+static int deadline_passed( const struct timespec *deadline )
+{
+    struct timespec now;
+
+    if( deadline == NULL ) return 0;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return now.tv_sec > deadline->tv_sec ||
+         ( now.tv_sec == deadline->tv_sec && now.tv_nsec >= deadline->tv_nsec );
+}
+
+
+int mpmc_queue_try_push( mpmc_queue_t *q, void *incoming )
+{
+    if( !try_push( q, incoming ) ) return EAGAIN;
+    signal_event( &q->push_event, &q->waiting_consumers );
+    return 0;
+}
+
+
+int mpmc_queue_timed_push( mpmc_queue_t *q, void *incoming, const struct timespec *deadline )
+{
+    unsigned event;
+    int      spins = 0;
+    int      rc;
+
+    while( !try_push( q, incoming ) ) {
+        if( ++spins < SPIN_LIMIT ) continue;
+        if( q->mode == MPMC_QUEUE_SPIN ) {
+            if( deadline_passed( deadline ) ) return ETIMEDOUT;
+            sched_yield( );
+            continue;
+        }
+
+        // Park until a consumer takes something out. The event is read before announcing the
+        // wait so a pop that happens after that point makes futex_wait return at once.
+        //
+        event = atomic_load( &q->pop_event );
+        atomic_fetch_add( &q->waiting_producers, 1 );
+        atomic_thread_fence( memory_order_seq_cst );
+        if( try_push( q, incoming ) ) {
+            atomic_fetch_sub( &q->waiting_producers, 1 );
+            break;
+        }
+        rc = futex_wait( &q->pop_event, event, deadline );
+        atomic_fetch_sub( &q->waiting_producers, 1 );
+        spins = 0;
+        if( rc == ETIMEDOUT ) {
+            if( try_push( q, incoming ) ) break;
+            return ETIMEDOUT;
+        }
+    }
+    signal_event( &q->push_event, &q->waiting_consumers );
+    return 0;
+}
+
+
+int mpmc_queue_try_pop( mpmc_queue_t *q, void **outgoing )
+{
+    if( !try_pop( q, outgoing ) ) return EAGAIN;
+    signal_event( &q->pop_event, &q->waiting_producers );
+    return 0;
+}
+
+
+int mpmc_queue_timed_pop( mpmc_queue_t *q, void **outgoing, const struct timespec *deadline )
+{
+    unsigned event;
+    int      spins = 0;
+    int      rc;
+
+    while( !try_pop( q, outgoing ) ) {
+        if( ++spins < SPIN_LIMIT ) continue;
+        if( q->mode == MPMC_QUEUE_SPIN ) {
+            if( deadline_passed( deadline ) ) return ETIMEDOUT;
+            sched_yield( );
+            continue;
+        }
+
+        // Park until a producer puts something in.
+        event = atomic_load( &q->push_event );
+        atomic_fetch_add( &q->waiting_consumers, 1 );
+        atomic_thread_fence( memory_order_seq_cst );
+        if( try_pop( q, outgoing ) ) {
+            atomic_fetch_sub( &q->waiting_consumers, 1 );
+            break;
+        }
+        rc = futex_wait( &q->push_event, event, deadline );
+        atomic_fetch_sub( &q->waiting_consumers, 1 );
+        spins = 0;
+        if( rc == ETIMEDOUT ) {
+            if( try_pop( q, outgoing ) ) break;
+            return ETIMEDOUT;
+        }
+    }
+    signal_event( &q->pop_event, &q->waiting_producers );
+    return 0;
+}
+
+
+void mpmc_queue_push( mpmc_queue_t *q, void *incoming )
+{
+    mpmc_queue_timed_push( q, incoming, NULL );
+}
+
+
+void *mpmc_queue_pop( mpmc_queue_t *q )
+{
+    void *return_value;
+
+    mpmc_queue_timed_pop( q, &return_value, NULL );
+    return return_value;
+}
+
+
+void mpmc_queue_push_many( mpmc_queue_t *q, void **incoming, int count )
+{
+    int pushed = 0;
+
+    // Add what fits without waiting and announce it once. Fall back to one at a time after that.
+    while( pushed < count && try_push( q, incoming[pushed] ) ) ++pushed;
+    if( pushed > 0 ) signal_event( &q->push_event, &q->waiting_consumers );
+    while( pushed < count ) mpmc_queue_push( q, incoming[pushed++] );
+}
+
+
+int mpmc_queue_pop_many( mpmc_queue_t *q, void **outgoing, int max )
+{
+    int popped = 1;
+
+    outgoing[0] = mpmc_queue_pop( q );
+    while( popped < max && try_pop( q, &outgoing[popped] ) ) ++popped;
+    if( popped > 1 ) signal_event( &q->pop_event, &q->waiting_producers );
+
+    return popped;
+}
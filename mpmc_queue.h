@@ -0,0 +1,72 @@
+/****************************************************************************
+FILE    : mpmc_queue.h
+SUBJECT : Interface to a lock free multi-producer/multi-consumer queue.
+AUTHOR  : (C) Copyright 2026 by Peter C. Chapin <pcc482719@gmail.com>
+
+This queue behaves like bounded_buffer: push blocks while the queue is full
+and pop blocks while it is empty. However there is no global lock. Each
+slot carries a sequence number that says whether it is ready to be filled
+or ready to be emptied for a particular lap around the queue, so producers
+and consumers only contend when they go after the same slot.
+
+A thread that can't make progress spins for a while. In MPMC_QUEUE_PARK
+mode it then goes to sleep on a futex until the other side makes a change.
+In MPMC_QUEUE_SPIN mode it never sleeps; it just yields the processor
+between attempts. That is only sensible when every thread has its own core.
+****************************************************************************/
+
+#ifndef MPMC_QUEUE_H
+#define MPMC_QUEUE_H
+
+#include <stdatomic.h>
+#include <time.h>
+#include "cache_line.h"
+
+#define MPMC_QUEUE_SIZE 8          // A reasonable default capacity.
+#define MPMC_QUEUE_MAX  (1 << 24)  // Largest capacity allowed.
+
+typedef enum { MPMC_QUEUE_PARK, MPMC_QUEUE_SPIN } mpmc_queue_mode;
+
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) atomic_uint sequence;
+    void *item;
+} mpmc_slot_t;
+
+typedef struct {
+    mpmc_slot_t *slots;
+    unsigned     mask;          // Capacity (a power of two) minus one.
+    _Alignas(CACHE_LINE_SIZE) atomic_uint enqueue_pos;
+    _Alignas(CACHE_LINE_SIZE) atomic_uint dequeue_pos;
+
+    // Parked threads sleep on these event counters.
+    _Alignas(CACHE_LINE_SIZE) atomic_uint push_event;
+    atomic_uint waiting_consumers;
+    _Alignas(CACHE_LINE_SIZE) atomic_uint pop_event;
+    atomic_uint waiting_producers;
+
+    mpmc_queue_mode mode;
+} mpmc_queue_t;
+
+// The capacity is rounded up to a power of two, and to at least two. Returns 0 or -1 if memory
+// runs out.
+int   mpmc_queue_init( mpmc_queue_t *, int capacity, mpmc_queue_mode );
+void  mpmc_queue_destroy( mpmc_queue_t * );
+void  mpmc_queue_push( mpmc_queue_t *, void * );
+void *mpmc_queue_pop( mpmc_queue_t * );
+
+// Push all count items. There is no lock to amortize, so this just saves on wakeups.
+void  mpmc_queue_push_many( mpmc_queue_t *, void **, int count );
+
+// Wait for at least one item and then take up to max items. Returns the number taken.
+int   mpmc_queue_pop_many( mpmc_queue_t *, void **, int max );
+
+// These return 0 on success. The try functions return EAGAIN instead of blocking. The timed
+// functions return ETIMEDOUT once the deadline, an absolute CLOCK_MONOTONIC time, has passed.
+// A NULL deadline waits forever.
+//
+int   mpmc_queue_try_push( mpmc_queue_t *, void * );
+int   mpmc_queue_try_pop( mpmc_queue_t *, void ** );
+int   mpmc_queue_timed_push( mpmc_queue_t *, void *, const struct timespec *deadline );
+int   mpmc_queue_timed_pop( mpmc_queue_t *, void **, const struct timespec *deadline );
+
+#endif
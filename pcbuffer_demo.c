@@ -10,6 +10,9 @@ at least verify that the functions in pcbuffer.c compile and do something
 useful without, for example, dumping core immediately. Building a more
 complete test program would be nice. Maybe someday.
 
+Compile with -DPCBUFFER_SPSC and link with spsc_ring.c to exercise the
+lock free single producer/single consumer version instead.
+
 Please send comments or bug reports to
 
      Peter Chapin
@@ -27,7 +30,7 @@ Please send comments or bug reports to
 
 #define OBJECT_COUNT 10000
 
-pcbuffer my_buffer;
+pcbuffer_t my_buffer;
 
 void *producer(void *arg)
 {
@@ -65,7 +68,7 @@ int main(void)
 {
   pthread_t p_ID, c_ID;
 
-  pcbuffer_init(&my_buffer);
+  pcbuffer_init(&my_buffer, PCBUFFER_SIZE);
   pthread_create(&p_ID, NULL, producer, NULL);
   pthread_create(&c_ID, NULL, consumer, NULL);
 
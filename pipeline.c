@@ -0,0 +1,216 @@
+/****************************************************************************
+FILE    : pipeline.c
+SUBJECT : Implementation of a generic multi-stage pipeline.
+AUTHOR  : (C) Copyright 2026 by Peter C. Chapin <pcc482719@gmail.com>
+
+The end of the stream travels down the pipeline as copies of end_marker.
+The source puts one in the first buffer for every thread of the first
+stage. A thread that takes a marker has seen everything it will see; the
+last thread of a stage to finish puts one marker per thread into the next
+stage's buffer, behind every item the stage produced.
+****************************************************************************/
+
+#include <errno.h>
+#include <stdlib.h>
+#include "pipeline.h"
+
+void pipeline_init( pipeline_t *p,
+                    pipeline_source_fn source, void *source_arg,
+                    pipeline_discard_fn discard, void *discard_arg,
+                    int queue_depth )
+{
+    p->source      = source;
+    p->source_arg  = source_arg;
+    p->discard     = discard;
+    p->discard_arg = discard_arg;
+    p->queue_depth = queue_depth;
+    p->stage_count = 0;
+    atomic_init( &p->error, 0 );
+}
+
+
+int pipeline_add_stage( pipeline_t *p, pipeline_stage_fn function, pipeline_flush_fn flush,
+                        void *arg, int degree, int ordered )
+{
+    pipeline_stage_t *stage;
+
+    if( p->stage_count == PIPELINE_MAX_STAGES || degree < 1 ) return EINVAL;
+    if( ordered && degree > 1 ) return EINVAL;
+#ifdef PCBUFFER_SPSC
+    if( degree > 1 ) return EINVAL;
+#endif
+    stage = &p->stages[p->stage_count];
+    stage->function = function;
+    stage->flush    = flush;
+    stage->arg      = arg;
+    stage->degree   = degree;
+    stage->ordered  = ordered;
+    stage->threads  = NULL;
+    stage->pipeline = p;
+    stage->index    = p->stage_count;
+    p->stage_count++;
+    return 0;
+}
+
+
+// Only the first error is kept.
+static void set_error( pipeline_t *p, int error )
+{
+    int expected = 0;
+
+    if( error != 0 ) atomic_compare_exchange_strong( &p->error, &expected, error );
+}
+
+
+static void send_end_markers( pipeline_t *p, pipeline_stage_t *stage )
+{
+    int i;
+
+    for( i = 0; i < stage->degree; ++i ) {
+        pcbuffer_push( &stage->input, &p->end_marker );
+    }
+}
+
+
+// Give an item to the stage's function, or discard it if the pipeline has failed.
+static void handle( pipeline_stage_t *stage, pipeline_stage_t *next, pipeline_item_t *item )
+{
+    pipeline_t *p = stage->pipeline;
+    int         error;
+
+    if( atomic_load( &p->error ) != 0 ) {
+        p->discard( item, p->discard_arg );
+        return;
+    }
+    if( ( error = stage->function( item, stage->arg ) ) != 0 ) {
+        set_error( p, error );
+        p->discard( item, p->discard_arg );
+        return;
+    }
+    if( next != NULL ) pcbuffer_push( &next->input, item );
+}
+
+
+static void *stage_thread( void *arg )
+{
+    pipeline_stage_t *stage = arg;
+    pipeline_t       *p     = stage->pipeline;
+    pipeline_stage_t *next  = ( stage->index + 1 < p->stage_count ) ? stage + 1 : NULL;
+    pipeline_item_t  *batch[PIPELINE_BATCH];
+    pipeline_item_t  *pending       = NULL;  // Ordered stages: early items, sorted by sequence.
+    long              next_sequence = 0;
+    pipeline_item_t **link;
+    pipeline_item_t  *item;
+    int               finished = 0;
+    int               count;
+    int               i;
+
+    while( !finished ) {
+        count = pcbuffer_pop_many( &stage->input, (void **)batch, PIPELINE_BATCH );
+        for( i = 0; i < count; ++i ) {
+            item = batch[i];
+            if( item == &p->end_marker ) {
+                // Any further markers in this batch belong to other threads of the stage.
+                if( finished ) pcbuffer_push( &stage->input, item );
+                finished = 1;
+                continue;
+            }
+            if( !stage->ordered ) {
+                handle( stage, next, item );
+                continue;
+            }
+
+            // Hold the item until every item before it has been handled.
+            for( link = &pending; *link != NULL && ( *link )->sequence < item->sequence;
+                 link = &( *link )->next ) ;
+            item->next = *link;
+            *link = item;
+            while( pending != NULL && pending->sequence == next_sequence ) {
+                item    = pending;
+                pending = pending->next;
+                next_sequence++;
+                handle( stage, next, item );
+            }
+        }
+        if( stage->flush != NULL ) set_error( p, stage->flush( stage->arg ) );
+    }
+
+    // Items can only be missing after an error; the upstream stage discarded them.
+    while( pending != NULL ) {
+        item    = pending;
+        pending = pending->next;
+        p->discard( item, p->discard_arg );
+    }
+
+    if( atomic_fetch_sub( &stage->active, 1 ) == 1 && next != NULL ) send_end_markers( p, next );
+    return NULL;
+}
+
+
+int pipeline_run( pipeline_t *p )
+{
+    pipeline_stage_t *stage;
+    pipeline_item_t  *item;
+    long              sequence = 0;
+    int               ready    = 0;  // Stages whose buffers have been created.
+    int               started;
+    int               error;
+    int               i;
+    int               j;
+
+    if( p->stage_count == 0 ) return EINVAL;
+    for( ready = 0; ready < p->stage_count; ++ready ) {
+        stage = &p->stages[ready];
+        stage->threads = malloc( stage->degree * sizeof( pthread_t ) );
+        if( stage->threads == NULL ) break;
+        if( pcbuffer_init( &stage->input, p->queue_depth ) == -1 ) {
+            free( stage->threads );
+            break;
+        }
+        atomic_init( &stage->active, stage->degree );
+    }
+    if( ready < p->stage_count ) {
+        set_error( p, ENOMEM );
+        goto clean_up;
+    }
+
+    // If some threads can't be started the source never runs. The end of the stream then flows
+    // through the threads that did start, each stage sending markers only to threads that exist.
+    for( i = 0; i < p->stage_count; ++i ) {
+        stage = &p->stages[i];
+        for( started = 0; started < stage->degree; ++started ) {
+            if( pthread_create( &stage->threads[started], NULL, stage_thread, stage ) != 0 ) break;
+        }
+        if( started < stage->degree ) {
+            set_error( p, EAGAIN );
+            atomic_store( &stage->active, started );
+            stage->degree = started;
+            for( j = i + 1; j < p->stage_count; ++j ) p->stages[j].degree = 0;
+            break;
+        }
+    }
+
+    while( atomic_load( &p->error ) == 0 ) {
+        if( ( error = p->source( &item, p->source_arg ) ) != 0 ) {
+            set_error( p, error );
+            break;
+        }
+        if( item == NULL ) break;
+        item->sequence = sequence++;
+        pcbuffer_push( &p->stages[0].input, item );
+    }
+    send_end_markers( p, &p->stages[0] );
+
+    for( i = 0; i < p->stage_count; ++i ) {
+        for( j = 0; j < p->stages[i].degree; ++j ) {
+            pthread_join( p->stages[i].threads[j], NULL );
+        }
+    }
+
+clean_up:
+    for( i = 0; i < ready; ++i ) {
+        pcbuffer_destroy( &p->stages[i].input );
+        free( p->stages[i].threads );
+    }
+    return atomic_load( &p->error );
+}
@@ -0,0 +1,102 @@
+/****************************************************************************
+FILE    : pipeline.h
+SUBJECT : Interface to a generic multi-stage pipeline.
+AUTHOR  : (C) Copyright 2026 by Peter C. Chapin <pcc482719@gmail.com>
+
+This module packages the pipeline model described in models.tex. A source
+function produces a stream of items and each stage in turn does something
+to every item, with the stages running in their own threads and connected
+by producer/consumer buffers (pcbuffer_t). The buffers are created by the
+pipeline; the program only supplies the functions.
+
+A stage has a parallelism degree, the number of threads that run its
+function on different items at once. An ordered stage sees the items in
+the order the source produced them, even when an earlier stage had
+several threads. Ordered stages always have one thread.
+
+Items are the program's own structures with a pipeline_item_t as their
+first member, which the pipeline uses for sequencing:
+
+    struct chunk {
+        pipeline_item_t link;
+        ...
+    };
+
+The source returns a new item each time it is called and NULL at the end
+of the stream. Each stage function works on an item in place and returns
+zero, or an error code to stop the pipeline. An item that leaves the last
+stage successfully belongs to that stage's function. An optional flush
+function is called after each batch of items a stage thread handles and
+once more when the stream ends, so a stage can gather up items and deal
+with several at once (writing them with one system call, say).
+
+Once there is an error the source is not called again and items still in
+the pipeline are handed to the discard function instead of to the stages.
+Flush functions are still called so stages can let go of what they hold.
+****************************************************************************/
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include "pcbuffer.h"
+
+#define PIPELINE_MAX_STAGES 16
+#define PIPELINE_BATCH      16  // Most items a stage thread takes from its buffer at once.
+
+typedef struct pipeline_item {
+    long                  sequence;  // Position in the stream, starting at zero.
+    struct pipeline_item *next;      // Used while an ordered stage holds the item back.
+} pipeline_item_t;
+
+// Sets *item to the next item or to NULL at the end of the stream. Returns 0 or an error code.
+typedef int  (*pipeline_source_fn)( pipeline_item_t **item, void *arg );
+typedef int  (*pipeline_stage_fn)( pipeline_item_t *item, void *arg );
+typedef int  (*pipeline_flush_fn)( void *arg );
+typedef void (*pipeline_discard_fn)( pipeline_item_t *item, void *arg );
+
+struct pipeline;
+
+typedef struct {
+    pipeline_stage_fn function;
+    pipeline_flush_fn flush;      // May be NULL.
+    void             *arg;
+    int               degree;
+    int               ordered;
+    pcbuffer_t        input;
+    atomic_int        active;     // Threads of this stage that haven't seen the end of the stream.
+    pthread_t        *threads;
+    struct pipeline  *pipeline;
+    int               index;
+} pipeline_stage_t;
+
+typedef struct pipeline {
+    pipeline_source_fn  source;
+    void               *source_arg;
+    pipeline_discard_fn discard;
+    void               *discard_arg;
+    int                 queue_depth;
+    int                 stage_count;
+    pipeline_stage_t    stages[PIPELINE_MAX_STAGES];
+    atomic_int          error;        // The first error reported, or zero.
+    pipeline_item_t     end_marker;   // Sent down the buffers to mark the end of the stream.
+} pipeline_t;
+
+void pipeline_init( pipeline_t *p,
+                    pipeline_source_fn source, void *source_arg,
+                    pipeline_discard_fn discard, void *discard_arg,
+                    int queue_depth );
+
+// Returns 0 or EINVAL if the stage can't be added (too many stages, a bad degree, or an ordered
+// stage with more than one thread). When the buffers are single producer/single consumer
+// (PCBUFFER_SPSC) every stage must have a degree of one.
+int  pipeline_add_stage( pipeline_t *p, pipeline_stage_fn function, pipeline_flush_fn flush,
+                         void *arg, int degree, int ordered );
+
+// Runs the source in the calling thread until the stream ends and every stage has finished.
+// Returns 0, the first error code reported by the program's functions, ENOMEM/EAGAIN if the
+// buffers or threads can't be had, or EINVAL if there are no stages.
+int  pipeline_run( pipeline_t *p );
+
+#endif
@@ -1,9 +1,25 @@
 /****************************************************************************
 FILE          : rwlock.c
-LAST REVISED  : 2007-11-22
+LAST REVISED  : 2026-10-16
 SUBJECT       : Reader/writer locks.
 PROGRAMMER    : (C) Copyright 2007 by Peter C. Chapin
 
+The lock is a monitor: one mutex protects the bookkeeping and readers and
+writers wait on separate condition variables. The policy only changes the
+conditions under which a waiting thread may go ahead.
+
+The big reader policy is different: readers stay away from the mutex unless
+a writer is around. A reader increments its slot and then looks for a
+writer; a writer sets writer_present and then looks at every slot. Both
+use sequentially consistent operations, so at least one of them sees the
+other. A reader that sees the writer undoes its increment and waits on the
+monitor until the writer leaves.
+
+At most one thread at a time holds an upgradable read lock. It reads side
+by side with ordinary readers but keeps writers and other upgraders out, so
+when it is promoted nothing can have changed since it looked. Promotion
+counts as a waiting writer and waits for the ordinary readers to leave.
+
 Please send comments or bug reports pertaining to this file to
 
      Peter C. Chapin
@@ -13,49 +29,376 @@ Please send comments or bug reports pertaining to this file to
      Peter.Chapin@vtc.vsc.edu
 ****************************************************************************/
 
+#include <errno.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
 #include "rwlock.h"
 
-void rw_init( rw_lock *lock )
+#define DRAIN_SPINS 100  // Slot polls before a draining writer starts yielding.
+
+// Threads are dealt slots round robin the first time they read lock any big reader lock.
+static atomic_int next_slot;
+static _Thread_local int my_slot = -1;
+
+static rw_slot *slot_of( rw_lock *lock )
 {
+    if( my_slot < 0 ) my_slot = atomic_fetch_add( &next_slot, 1 ) & 0x7FFFFFFF;
+    return &lock->slots[my_slot % lock->slot_count];
+}
+
+
+int rw_init( rw_lock *lock, rw_policy policy )
+{
+    pthread_condattr_t attributes;
+    long processors;
+    int  i;
+
+    lock->slots      = NULL;
+    lock->slot_count = 0;
+    atomic_init( &lock->writer_present, 0 );
+    if( policy == RW_BIG_READER ) {
+        processors = sysconf( _SC_NPROCESSORS_ONLN );
+        lock->slot_count = ( processors < 1 ) ? 1 : (int)processors;
+        lock->slots = aligned_alloc( CACHE_LINE_SIZE, lock->slot_count * sizeof( rw_slot ) );
+        if( lock->slots == NULL ) return -1;
+        for( i = 0; i < lock->slot_count; ++i ) {
+            atomic_init( &lock->slots[i].readers, 0 );
+        }
+    }
+
+    // Deadlines for the timed functions are measured on the monotonic clock.
+    pthread_condattr_init( &attributes );
+    pthread_condattr_setclock( &attributes, CLOCK_MONOTONIC );
     pthread_mutex_init( &lock->mutex, NULL );
-    pthread_mutex_init( &lock->wrt, NULL );
-    lock->readcount = 0;
+    pthread_cond_init( &lock->readers_ok, &attributes );
+    pthread_cond_init( &lock->writers_ok, &attributes );
+    pthread_cond_init( &lock->upgraders_ok, &attributes );
+    pthread_cond_init( &lock->promote_ok, &attributes );
+    pthread_condattr_destroy( &attributes );
+    lock->policy            = policy;
+    lock->readcount         = 0;
+    lock->writing           = 0;
+    lock->waiting_readers   = 0;
+    lock->waiting_writers   = 0;
+    lock->read_phase        = 0;
+    lock->admitted_readers  = 0;
+    lock->upgrader          = 0;
+    lock->waiting_upgraders = 0;
+    lock->promoting         = 0;
+    return 0;
 }
 
 
 void rw_destroy( rw_lock *lock )
 {
     pthread_mutex_destroy( &lock->mutex );
-    pthread_mutex_destroy( &lock->wrt );
+    pthread_cond_destroy( &lock->readers_ok );
+    pthread_cond_destroy( &lock->writers_ok );
+    pthread_cond_destroy( &lock->upgraders_ok );
+    pthread_cond_destroy( &lock->promote_ok );
+    free( lock->slots );
 }
 
 
-void read_lock( rw_lock *lock )
+// Wait on a condition until the deadline (NULL means forever).
+static int wait( pthread_cond_t *condition, pthread_mutex_t *mutex, const struct timespec *deadline )
+{
+    if( deadline == NULL ) return pthread_cond_wait( condition, mutex );
+    return pthread_cond_timedwait( condition, mutex, deadline );
+}
+
+
+static int deadline_passed( const struct timespec *deadline )
 {
+    struct timespec now;
+
+    if( deadline == NULL ) return 0;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return now.tv_sec > deadline->tv_sec ||
+           ( now.tv_sec == deadline->tv_sec && now.tv_nsec >= deadline->tv_nsec );
+}
+
+
+// May a reader that started waiting during the given phase go ahead? Call with the mutex held.
+static int reader_may_enter( rw_lock *lock, unsigned phase )
+{
+    if( lock->writing ) return 0;
+    switch( lock->policy ) {
+    case RW_PREFER_WRITERS: return lock->waiting_writers == 0;
+    case RW_PHASE_FAIR:     return lock->waiting_writers == 0 || lock->read_phase != phase;
+    default:                return 1;
+    }
+}
+
+
+static int writer_may_enter( rw_lock *lock )
+{
+    return !lock->writing && lock->readcount == 0 && lock->admitted_readers == 0 && !lock->upgrader;
+}
+
+
+// Upgraders only jump the queue of writers when the policy lets readers do so.
+static int upgrader_may_enter( rw_lock *lock )
+{
+    if( lock->writing || lock->upgrader ) return 0;
+    if( lock->policy == RW_PREFER_WRITERS || lock->policy == RW_PHASE_FAIR )
+        return lock->waiting_writers == 0;
+    return 1;
+}
+
+
+static int big_read_lock( rw_lock *lock, const struct timespec *deadline )
+{
+    rw_slot *slot = slot_of( lock );
+
+    for( ;; ) {
+        atomic_fetch_add( &slot->readers, 1 );
+        if( !atomic_load( &lock->writer_present ) ) return 0;
+        atomic_fetch_sub( &slot->readers, 1 );
+
+        pthread_mutex_lock( &lock->mutex );
+        lock->waiting_readers++;
+        while( atomic_load( &lock->writer_present ) ) {
+            if( wait( &lock->readers_ok, &lock->mutex, deadline ) == ETIMEDOUT &&
+                atomic_load( &lock->writer_present ) ) {
+                lock->waiting_readers--;
+                pthread_mutex_unlock( &lock->mutex );
+                return ETIMEDOUT;
+            }
+        }
+        lock->waiting_readers--;
+        pthread_mutex_unlock( &lock->mutex );
+    }
+}
+
+
+// Wait until no reader holds a big reader lock. Call after setting writer_present.
+static int drain_readers( rw_lock *lock, const struct timespec *deadline )
+{
+    int i;
+    int spins;
+
+    for( i = 0; i < lock->slot_count; ++i ) {
+        spins = 0;
+        while( atomic_load( &lock->slots[i].readers ) != 0 ) {
+            if( ++spins > DRAIN_SPINS ) {
+                if( deadline_passed( deadline ) ) return ETIMEDOUT;
+                sched_yield( );
+            }
+        }
+    }
+    return 0;
+}
+
+
+// Wake whoever might be able to proceed after a waiting writer gave up. Call with the mutex held.
+static void writer_gave_up( rw_lock *lock )
+{
+    if( lock->waiting_readers > 0 ) pthread_cond_broadcast( &lock->readers_ok );
+    if( lock->waiting_upgraders > 0 ) pthread_cond_signal( &lock->upgraders_ok );
+
+    // We may have taken the wakeup meant for another writer.
+    if( lock->waiting_writers > 0 ) pthread_cond_signal( &lock->writers_ok );
+}
+
+
+int timed_read_lock( rw_lock *lock, const struct timespec *deadline )
+{
+    unsigned phase;
+
+    if( lock->policy == RW_BIG_READER ) return big_read_lock( lock, deadline );
+
     pthread_mutex_lock( &lock->mutex );
+    phase = lock->read_phase;
+    if( !reader_may_enter( lock, phase ) ) {
+        lock->waiting_readers++;
+        while( !reader_may_enter( lock, phase ) ) {
+            if( wait( &lock->readers_ok, &lock->mutex, deadline ) == ETIMEDOUT &&
+                !reader_may_enter( lock, phase ) ) {
+                lock->waiting_readers--;
+                pthread_mutex_unlock( &lock->mutex );
+                return ETIMEDOUT;
+            }
+        }
+        lock->waiting_readers--;
+
+        // A phase change means a writer counted us among the readers it let in.
+        if( lock->read_phase != phase ) lock->admitted_readers--;
+    }
     lock->readcount++;
-    if( lock->readcount == 1 ) pthread_mutex_lock( &lock->wrt );
     pthread_mutex_unlock( &lock->mutex );
+    return 0;
+}
+
+
+int try_read_lock( rw_lock *lock )
+{
+    rw_slot *slot;
+    int      result = 0;
+
+    if( lock->policy == RW_BIG_READER ) {
+        slot = slot_of( lock );
+        atomic_fetch_add( &slot->readers, 1 );
+        if( !atomic_load( &lock->writer_present ) ) return 0;
+        atomic_fetch_sub( &slot->readers, 1 );
+        return EBUSY;
+    }
+    pthread_mutex_lock( &lock->mutex );
+    if( reader_may_enter( lock, lock->read_phase ) )
+        lock->readcount++;
+    else
+        result = EBUSY;
+    pthread_mutex_unlock( &lock->mutex );
+    return result;
+}
+
+
+void read_lock( rw_lock *lock )
+{
+    timed_read_lock( lock, NULL );
 }
 
 
 void read_unlock( rw_lock *lock )
 {
+    if( lock->policy == RW_BIG_READER ) {
+        atomic_fetch_sub( &slot_of( lock )->readers, 1 );
+        return;
+    }
     pthread_mutex_lock( &lock->mutex );
     lock->readcount--;
-    if( lock->readcount == 0 ) pthread_mutex_unlock( &lock->wrt );
+    if( lock->readcount == 0 ) {
+        if( lock->promoting ) pthread_cond_signal( &lock->promote_ok );
+        if( lock->waiting_writers > 0 ) pthread_cond_signal( &lock->writers_ok );
+    }
     pthread_mutex_unlock( &lock->mutex );
 }
 
 
+// Called with the mutex held once this thread has set writing. Releases the mutex.
+static int finish_write_lock( rw_lock *lock, const struct timespec *deadline )
+{
+    if( lock->policy != RW_BIG_READER ) {
+        pthread_mutex_unlock( &lock->mutex );
+        return 0;
+    }
+    atomic_store( &lock->writer_present, 1 );
+    pthread_mutex_unlock( &lock->mutex );
+    if( drain_readers( lock, deadline ) == ETIMEDOUT ) {
+        write_unlock( lock );
+        return ETIMEDOUT;
+    }
+    return 0;
+}
+
+
+int timed_write_lock( rw_lock *lock, const struct timespec *deadline )
+{
+    pthread_mutex_lock( &lock->mutex );
+    lock->waiting_writers++;
+    while( !writer_may_enter( lock ) ) {
+        if( wait( &lock->writers_ok, &lock->mutex, deadline ) == ETIMEDOUT &&
+            !writer_may_enter( lock ) ) {
+            lock->waiting_writers--;
+            writer_gave_up( lock );
+            pthread_mutex_unlock( &lock->mutex );
+            return ETIMEDOUT;
+        }
+    }
+    lock->waiting_writers--;
+    lock->writing = 1;
+    return finish_write_lock( lock, deadline );
+}
+
+
+int try_write_lock( rw_lock *lock )
+{
+    int i;
+
+    pthread_mutex_lock( &lock->mutex );
+    if( !writer_may_enter( lock ) ) {
+        pthread_mutex_unlock( &lock->mutex );
+        return EBUSY;
+    }
+    lock->writing = 1;
+    if( lock->policy != RW_BIG_READER ) {
+        pthread_mutex_unlock( &lock->mutex );
+        return 0;
+    }
+    atomic_store( &lock->writer_present, 1 );
+    pthread_mutex_unlock( &lock->mutex );
+    for( i = 0; i < lock->slot_count; ++i ) {
+        if( atomic_load( &lock->slots[i].readers ) != 0 ) {
+            write_unlock( lock );
+            return EBUSY;
+        }
+    }
+    return 0;
+}
+
+
 void write_lock( rw_lock *lock )
 {
-    pthread_mutex_lock( &lock->wrt );
+    timed_write_lock( lock, NULL );
 }
 
 
 void write_unlock( rw_lock *lock )
 {
-    pthread_mutex_unlock( &lock->wrt );
+    pthread_mutex_lock( &lock->mutex );
+    lock->writing = 0;
+    atomic_store( &lock->writer_present, 0 );
+
+    // Under the phase fair policy the readers that waited for this writer go before any writer.
+    if( lock->policy == RW_PHASE_FAIR && lock->waiting_readers > 0 ) {
+        lock->read_phase++;
+        lock->admitted_readers = lock->waiting_readers;
+    }
+    if( lock->waiting_readers > 0 ) pthread_cond_broadcast( &lock->readers_ok );
+    if( lock->waiting_upgraders > 0 ) pthread_cond_signal( &lock->upgraders_ok );
+    if( lock->waiting_writers > 0 ) pthread_cond_signal( &lock->writers_ok );
+    pthread_mutex_unlock( &lock->mutex );
+}
+
+
+void upgrade_lock( rw_lock *lock )
+{
+    pthread_mutex_lock( &lock->mutex );
+    lock->waiting_upgraders++;
+    while( !upgrader_may_enter( lock ) )
+        pthread_cond_wait( &lock->upgraders_ok, &lock->mutex );
+    lock->waiting_upgraders--;
+    lock->upgrader = 1;
+    pthread_mutex_unlock( &lock->mutex );
 }
 
+
+void upgrade_unlock( rw_lock *lock )
+{
+    pthread_mutex_lock( &lock->mutex );
+    lock->upgrader = 0;
+    if( lock->waiting_upgraders > 0 ) pthread_cond_signal( &lock->upgraders_ok );
+    if( lock->waiting_writers > 0 ) pthread_cond_signal( &lock->writers_ok );
+    pthread_mutex_unlock( &lock->mutex );
+}
+
+
+void upgrade_to_write( rw_lock *lock )
+{
+    pthread_mutex_lock( &lock->mutex );
+
+    // Counting as a waiting writer holds off new readers under the writer friendly policies.
+    lock->waiting_writers++;
+    lock->promoting = 1;
+    while( lock->readcount > 0 || lock->admitted_readers > 0 )
+        pthread_cond_wait( &lock->promote_ok, &lock->mutex );
+    lock->promoting = 0;
+    lock->waiting_writers--;
+
+    // Writers and other upgraders were kept out all along, so the hand over is atomic.
+    lock->upgrader = 0;
+    lock->writing  = 1;
+    finish_write_lock( lock, NULL );
+}
@@ -1,12 +1,40 @@
 /****************************************************************************
 FILE          : rwlock.h
-LAST REVISED  : 2007-11-22
+LAST REVISED  : 2026-10-16
 SUBJECT       : Reader/writer locks.
 PROGRAMMER    : (C) Copyright 2007 by Peter C. Chapin
 
 This file contains the declaration of several functions that allow for
 reader/writer locks. The function names should be fairly self-explanatory.
 
+The policy given to rw_init decides who goes first when readers and
+writers are both waiting.
+
+  RW_PREFER_READERS: Readers get in whenever no writer holds the lock. This
+  is the classic design, but a steady stream of readers starves writers.
+
+  RW_PREFER_WRITERS: New readers wait while any writer is waiting. Writers
+  can't starve but readers can.
+
+  RW_PHASE_FAIR: Reading and writing alternate. A waiting writer holds off
+  new readers, but when a writer leaves, every reader that was waiting gets
+  in before the next writer. Neither side can starve.
+
+  RW_BIG_READER: For data that is read far more often than it is written.
+  Each thread counts its reads in its own cache line sized slot, so readers
+  never touch a line that other readers write and read_lock scales with the
+  number of cores. A writer announces itself and then waits for every slot
+  to drain, which makes write_lock expensive. Readers back off while a
+  writer is present. rw_lock never moves a thread to a different slot, so a
+  thread must release a read lock itself.
+
+A thread that reads and then perhaps writes can take an upgradable read
+lock with upgrade_lock. It shares the lock with ordinary readers, but only
+one upgrader is let in at a time and writers are kept out, so
+upgrade_to_write can later turn it into a write lock without letting
+anybody else change the data in between. After upgrade_to_write release
+the lock with write_unlock; otherwise release it with upgrade_unlock.
+
 Please send comments or bug reports pertaining to this file to
 
      Peter C. Chapin
@@ -20,24 +48,62 @@ Please send comments or bug reports pertaining to this file to
 #define RWLOCK_H
 
 #include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include "cache_line.h"
+
+typedef enum { RW_PREFER_READERS, RW_PREFER_WRITERS, RW_PHASE_FAIR, RW_BIG_READER } rw_policy;
+
+// Big reader mode: the read count of the threads that share a slot.
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) atomic_int readers;
+} rw_slot;
 
 typedef struct {
     pthread_mutex_t mutex;
-    pthread_mutex_t wrt;
-    int             readcount;
+    pthread_cond_t  readers_ok;
+    pthread_cond_t  writers_ok;
+    pthread_cond_t  upgraders_ok;
+    pthread_cond_t  promote_ok;        // The upgrader waits here for readers to leave.
+    rw_policy       policy;
+    int             readcount;         // Readers holding the lock.
+    int             writing;           // Non-zero while a writer holds the lock.
+    int             waiting_readers;
+    int             waiting_writers;
+    unsigned        read_phase;        // Phase fair: advanced when a writer lets readers in.
+    int             admitted_readers;  // Phase fair: readers let in that haven't entered yet.
+    rw_slot        *slots;             // Big reader: one per processor, NULL otherwise.
+    int             slot_count;
+    atomic_int      writer_present;    // Big reader: set while a writer holds or drains the lock.
+    int             upgrader;          // Non-zero while a thread holds the upgradable read lock.
+    int             waiting_upgraders;
+    int             promoting;         // Non-zero while the upgrader waits in upgrade_to_write.
 } rw_lock;
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-void rw_init     ( rw_lock * );
+// Returns 0 or -1 if memory for the big reader slots runs out.
+int  rw_init     ( rw_lock *, rw_policy );
 void rw_destroy  ( rw_lock * );
 void read_lock   ( rw_lock * );
 void read_unlock ( rw_lock * );
 void write_lock  ( rw_lock * );
 void write_unlock( rw_lock * );
 
+// These return 0 once the lock is held. The try functions return EBUSY instead of blocking. The
+// timed functions return ETIMEDOUT once the deadline, an absolute CLOCK_MONOTONIC time, has
+// passed. A NULL deadline waits forever.
+int  try_read_lock   ( rw_lock * );
+int  try_write_lock  ( rw_lock * );
+int  timed_read_lock ( rw_lock *, const struct timespec *deadline );
+int  timed_write_lock( rw_lock *, const struct timespec *deadline );
+
+void upgrade_lock    ( rw_lock * );
+void upgrade_unlock  ( rw_lock * );
+void upgrade_to_write( rw_lock * );
+
 #ifdef __cplusplus
 }
 #endif
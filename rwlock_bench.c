@@ -0,0 +1,155 @@
+/****************************************************************************
+FILE          : rwlock_bench.c
+SUBJECT       : Read throughput of rw_lock as the number of readers grows.
+PROGRAMMER    : (C) Copyright 2026 by Peter C. Chapin <pcc482719@gmail.com>
+
+For reader counts 1, 2, 4, ... up to the number of processors (or the
+given maximum) every thread takes and releases a read lock in a tight
+loop for a fixed time. There are no writers. The program prints the total
+number of read lock/unlock pairs per second for the ordinary
+readers-preferred lock, for the big reader lock and, for comparison, for
+pthread_rwlock_t.
+
+The ordinary lock's mutex and read count are shared by every reader, so
+its throughput stays flat (or drops) as readers are added. The big reader
+lock should scale roughly with the number of cores.
+
+Usage: rwlock_bench [max_threads [milliseconds]]
+
+Build with:
+  gcc -O2 -pthread -o rwlock_bench rwlock_bench.c rwlock.c
+****************************************************************************/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "cache_line.h"
+#include "rwlock.h"
+
+typedef enum { READERS_PREFERRED, BIG_READER, POSIX, KIND_COUNT } lock_kind;
+
+static const char *kind_names[KIND_COUNT] = {
+    "RW_PREFER_READERS", "RW_BIG_READER", "pthread_rwlock_t"
+};
+
+// Each thread counts its own operations on its own cache line.
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) long count;
+} counter_t;
+
+// Everything the threads of one measurement need.
+static lock_kind         kind;
+static rw_lock           lock;
+static pthread_rwlock_t  posix_lock;
+static atomic_int        stop;
+static counter_t        *counters;
+static pthread_barrier_t start_barrier;
+static long              shared_value;
+
+
+static void *reader( void *arg )
+{
+    counter_t    *counter = arg;
+    volatile long sink;
+    long          count = 0;
+
+    pthread_barrier_wait( &start_barrier );
+    while( !atomic_load_explicit( &stop, memory_order_relaxed ) ) {
+        if( kind == POSIX ) {
+            pthread_rwlock_rdlock( &posix_lock );
+            sink = shared_value;
+            pthread_rwlock_unlock( &posix_lock );
+        }
+        else {
+            read_lock( &lock );
+            sink = shared_value;
+            read_unlock( &lock );
+        }
+        ++count;
+    }
+    (void)sink;
+    counter->count = count;
+    return NULL;
+}
+
+
+// Returns the number of lock/unlock pairs per second.
+static double measure( int thread_count, long milliseconds )
+{
+    pthread_t      *IDs = malloc( thread_count * sizeof( pthread_t ) );
+    struct timespec duration = { milliseconds / 1000, ( milliseconds % 1000 ) * 1000000L };
+    double          total = 0.0;
+    int             i;
+
+    if( kind == POSIX )
+        pthread_rwlock_init( &posix_lock, NULL );
+    else if( rw_init( &lock, ( kind == BIG_READER ) ? RW_BIG_READER : RW_PREFER_READERS ) != 0 ) {
+        fprintf( stderr, "Unable to initialize the lock\n" );
+        exit( EXIT_FAILURE );
+    }
+    atomic_store( &stop, 0 );
+    pthread_barrier_init( &start_barrier, NULL, thread_count + 1 );
+
+    for( i = 0; i < thread_count; ++i ) {
+        pthread_create( &IDs[i], NULL, reader, &counters[i] );
+    }
+    pthread_barrier_wait( &start_barrier );
+    nanosleep( &duration, NULL );
+    atomic_store( &stop, 1 );
+    for( i = 0; i < thread_count; ++i ) {
+        pthread_join( IDs[i], NULL );
+        total += counters[i].count;
+    }
+
+    pthread_barrier_destroy( &start_barrier );
+    if( kind == POSIX )
+        pthread_rwlock_destroy( &posix_lock );
+    else
+        rw_destroy( &lock );
+    free( IDs );
+    return total * 1000.0 / milliseconds;
+}
+
+
+int main( int argc, char **argv )
+{
+    int  max_threads  = (int)sysconf( _SC_NPROCESSORS_ONLN );
+    long milliseconds = 500;
+    int  thread_count;
+
+    if( argc > 1 ) max_threads  = atoi( argv[1] );
+    if( argc > 2 ) milliseconds = atol( argv[2] );
+    if( max_threads < 1 || milliseconds < 1 ) {
+        fprintf( stderr, "Usage: %s [max_threads [milliseconds]]\n", argv[0] );
+        return EXIT_FAILURE;
+    }
+    counters = aligned_alloc( CACHE_LINE_SIZE, max_threads * sizeof( counter_t ) );
+    if( counters == NULL ) {
+        fprintf( stderr, "Out of memory\n" );
+        return EXIT_FAILURE;
+    }
+
+    printf( "%7s", "threads" );
+    for( kind = 0; kind < KIND_COUNT; ++kind ) printf( " %22s", kind_names[kind] );
+    printf( "\n" );
+
+    // Powers of two, then max_threads itself if it isn't one.
+    for( thread_count = 1; ; thread_count *= 2 ) {
+        if( thread_count > max_threads ) thread_count = max_threads;
+        printf( "%7d", thread_count );
+        for( kind = 0; kind < KIND_COUNT; ++kind ) {
+            printf( " %15.2f Mops/s", measure( thread_count, milliseconds ) / 1e6 );
+            fflush( stdout );
+        }
+        printf( "\n" );
+        if( thread_count == max_threads ) break;
+    }
+    free( counters );
+    return EXIT_SUCCESS;
+}
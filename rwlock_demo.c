@@ -0,0 +1,321 @@
+/****************************************************************************
+FILE          : rwlock_demo.c
+SUBJECT       : Measure how long writers wait under each rw_lock policy.
+PROGRAMMER    : (C) Copyright 2026 by Peter C. Chapin <pcc482719@gmail.com>
+
+A group of reader threads take the lock over and over, holding it for a
+short time each, so the lock is almost never free of readers. Meanwhile a
+single writer asks for the lock a number of times and records how long
+each request waits. The program reports the worst and average wait for
+each policy.
+
+With RW_PREFER_READERS the writer may never get in at all. Each run is
+cut off after a time limit by stopping the readers; writes that only got
+through because of that are still counted, so a starved writer shows a
+worst case close to the limit.
+
+Before the timing runs the program checks, under every policy, the parts
+of the interface the runs don't use: an upgradable read lock taken while
+other threads read is promoted to a write lock without a waiting writer
+getting in first, try_write_lock and try_read_lock return EBUSY when they
+would block, and the timed functions return ETIMEDOUT. If any check fails
+the program says so and exits with a failure status.
+
+Usage: rwlock_demo [readers [writes [limit_ms]]]
+
+Build with:
+  gcc -O2 -pthread -o rwlock_demo rwlock_demo.c rwlock.c
+****************************************************************************/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "rwlock.h"
+
+#define HOLD_NS      20000L    // How long a reader keeps the lock.
+#define WRITE_GAP_NS 1000000L  // Pause between the writer's requests.
+#define SETTLE_NS    20000000L // Time given to other threads to start waiting.
+#define TIMEOUT_NS   20000000L // How long the timed functions are given.
+#define HOLDERS      3         // Readers sharing the lock with the upgrader.
+
+static const char *policy_names[] = {
+    "RW_PREFER_READERS", "RW_PREFER_WRITERS", "RW_PHASE_FAIR", "RW_BIG_READER"
+};
+
+// Everything the threads of one run need.
+static rw_lock    lock;
+static atomic_int stop;
+static atomic_int writer_done;
+static int        writes;
+static int        writes_completed;  // Writes that got in before the readers were stopped.
+static double     max_wait;
+static double     total_wait;
+static long       shared_value;      // The "data" the lock protects.
+
+// Used by the checks.
+static atomic_int holding;           // Readers that have the lock.
+static atomic_int release;           // Tells the readers to let go.
+static atomic_int intruded;          // Set by a writer once it gets in.
+
+
+static double now( void )
+{
+    struct timespec t;
+
+    clock_gettime( CLOCK_MONOTONIC, &t );
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+
+static void *reader( void *arg )
+{
+    volatile long sink;
+    double        start;
+
+    (void)arg;
+    while( !atomic_load( &stop ) ) {
+        read_lock( &lock );
+        start = now( );
+        while( now( ) - start < HOLD_NS ) sink = shared_value;
+        read_unlock( &lock );
+    }
+    (void)sink;
+    return NULL;
+}
+
+
+// Hold a read lock until told to let go.
+static void *holder( void *arg )
+{
+    struct timespec tick = { 0, 1000000L };
+
+    (void)arg;
+    read_lock( &lock );
+    atomic_fetch_add( &holding, 1 );
+    while( !atomic_load( &release ) ) nanosleep( &tick, NULL );
+    read_unlock( &lock );
+    return NULL;
+}
+
+
+// Wait for the write lock and note when it comes.
+static void *intruder( void *arg )
+{
+    (void)arg;
+    write_lock( &lock );
+    atomic_store( &intruded, 1 );
+    shared_value++;
+    write_unlock( &lock );
+    return NULL;
+}
+
+
+static void deadline_after( struct timespec *deadline, long ns )
+{
+    clock_gettime( CLOCK_MONOTONIC, deadline );
+    deadline->tv_nsec += ns;
+    deadline->tv_sec  += deadline->tv_nsec / 1000000000L;
+    deadline->tv_nsec %= 1000000000L;
+}
+
+
+static int expect( int condition, rw_policy policy, const char *what )
+{
+    if( !condition ) printf( "%-18s FAILED: %s\n", policy_names[policy], what );
+    return condition ? 0 : 1;
+}
+
+
+// Take an upgradable lock alongside ordinary readers, let a writer start waiting, then promote.
+// The writer must not get in until the promoted lock is released.
+static int check_upgrade( rw_policy policy )
+{
+    struct timespec settle = { 0, SETTLE_NS };
+    struct timespec tick   = { 0, 1000000L };
+    pthread_t       holders[HOLDERS];
+    pthread_t       intruder_ID;
+    long            seen;
+    int             failures = 0;
+    int             i;
+
+    atomic_store( &holding, 0 );
+    atomic_store( &release, 0 );
+    atomic_store( &intruded, 0 );
+    for( i = 0; i < HOLDERS; ++i ) {
+        pthread_create( &holders[i], NULL, holder, NULL );
+    }
+    while( atomic_load( &holding ) < HOLDERS ) nanosleep( &tick, NULL );
+
+    upgrade_lock( &lock );
+    seen = shared_value;
+    pthread_create( &intruder_ID, NULL, intruder, NULL );
+    nanosleep( &settle, NULL );
+
+    atomic_store( &release, 1 );
+    upgrade_to_write( &lock );
+    failures += expect( !atomic_load( &intruded ) && shared_value == seen,
+                        policy, "a writer got in before the promotion" );
+    shared_value = seen + 1000;
+    nanosleep( &settle, NULL );
+    failures += expect( !atomic_load( &intruded ), policy, "a writer got in with the promoted lock" );
+    write_unlock( &lock );
+
+    pthread_join( intruder_ID, NULL );
+    for( i = 0; i < HOLDERS; ++i ) {
+        pthread_join( holders[i], NULL );
+    }
+    failures += expect( shared_value == seen + 1001, policy, "the waiting writer was lost" );
+
+    // An upgrader alone still keeps writers out. Without promotion it just leaves.
+    upgrade_lock( &lock );
+    failures += expect( try_write_lock( &lock ) == EBUSY, policy, "try_write_lock beside an upgrader" );
+    upgrade_unlock( &lock );
+    failures += expect( try_write_lock( &lock ) == 0, policy, "upgrade_unlock kept writers out" );
+    write_unlock( &lock );
+    return failures;
+}
+
+
+// The try and timed functions give up when they should, and leave the lock usable.
+static int check_give_up( rw_policy policy )
+{
+    struct timespec deadline;
+    int             failures = 0;
+
+    read_lock( &lock );
+    failures += expect( try_write_lock( &lock ) == EBUSY, policy, "try_write_lock beside a reader" );
+    deadline_after( &deadline, TIMEOUT_NS );
+    failures += expect( timed_write_lock( &lock, &deadline ) == ETIMEDOUT,
+                        policy, "timed_write_lock beside a reader" );
+    failures += expect( try_read_lock( &lock ) == 0, policy, "a reader after a writer timed out" );
+    read_unlock( &lock );
+    read_unlock( &lock );
+
+    write_lock( &lock );
+    failures += expect( try_read_lock( &lock ) == EBUSY, policy, "try_read_lock beside a writer" );
+    deadline_after( &deadline, TIMEOUT_NS );
+    failures += expect( timed_read_lock( &lock, &deadline ) == ETIMEDOUT,
+                        policy, "timed_read_lock beside a writer" );
+    write_unlock( &lock );
+
+    deadline_after( &deadline, TIMEOUT_NS );
+    failures += expect( timed_write_lock( &lock, &deadline ) == 0, policy, "timed_write_lock when free" );
+    write_unlock( &lock );
+    deadline_after( &deadline, TIMEOUT_NS );
+    failures += expect( timed_read_lock( &lock, &deadline ) == 0, policy, "timed_read_lock when free" );
+    read_unlock( &lock );
+    return failures;
+}
+
+
+static int check( rw_policy policy )
+{
+    int failures;
+
+    if( rw_init( &lock, policy ) != 0 ) {
+        fprintf( stderr, "Unable to initialize the lock for %s\n", policy_names[policy] );
+        exit( EXIT_FAILURE );
+    }
+    failures  = check_upgrade( policy );
+    failures += check_give_up( policy );
+    rw_destroy( &lock );
+    if( failures == 0 ) printf( "%-18s checks passed\n", policy_names[policy] );
+    return failures;
+}
+
+
+static void *writer( void *arg )
+{
+    struct timespec gap = { 0, WRITE_GAP_NS };
+    double          start;
+    double          wait;
+    int             i;
+
+    (void)arg;
+    for( i = 0; i < writes; ++i ) {
+        start = now( );
+        write_lock( &lock );
+        wait = now( ) - start;
+        if( !atomic_load( &stop ) ) writes_completed++;
+        shared_value++;
+        write_unlock( &lock );
+
+        if( wait > max_wait ) max_wait = wait;
+        total_wait += wait;
+        nanosleep( &gap, NULL );
+    }
+    atomic_store( &writer_done, 1 );
+    return NULL;
+}
+
+
+static void run( rw_policy policy, int reader_count, double limit_ns )
+{
+    pthread_t      *readers = malloc( reader_count * sizeof( pthread_t ) );
+    pthread_t       writer_ID;
+    struct timespec tick = { 0, 10000000L };
+    double          start;
+    int             i;
+
+    if( rw_init( &lock, policy ) != 0 ) {
+        fprintf( stderr, "Unable to initialize the lock for %s\n", policy_names[policy] );
+        exit( EXIT_FAILURE );
+    }
+    atomic_store( &stop, 0 );
+    atomic_store( &writer_done, 0 );
+    writes_completed = 0;
+    max_wait   = 0.0;
+    total_wait = 0.0;
+
+    for( i = 0; i < reader_count; ++i ) {
+        pthread_create( &readers[i], NULL, reader, NULL );
+    }
+    pthread_create( &writer_ID, NULL, writer, NULL );
+
+    start = now( );
+    while( !atomic_load( &writer_done ) && now( ) - start < limit_ns ) nanosleep( &tick, NULL );
+    atomic_store( &stop, 1 );
+
+    pthread_join( writer_ID, NULL );
+    for( i = 0; i < reader_count; ++i ) {
+        pthread_join( readers[i], NULL );
+    }
+    rw_destroy( &lock );
+    free( readers );
+
+    printf( "%-18s %6d/%-6d %14.3f %14.3f\n",
+            policy_names[policy], writes_completed, writes, max_wait / 1e6, total_wait / writes / 1e6 );
+}
+
+
+int main( int argc, char **argv )
+{
+    int    reader_count = 4;
+    double limit_ms     = 2000.0;
+
+    writes = 100;
+    if( argc > 1 ) reader_count = atoi( argv[1] );
+    if( argc > 2 ) writes       = atoi( argv[2] );
+    if( argc > 3 ) limit_ms     = atof( argv[3] );
+    if( reader_count < 1 || writes < 1 || limit_ms <= 0.0 ) {
+        fprintf( stderr, "Usage: %s [readers [writes [limit_ms]]]\n", argv[0] );
+        return EXIT_FAILURE;
+    }
+
+    if( check( RW_PREFER_READERS ) + check( RW_PREFER_WRITERS ) +
+        check( RW_PHASE_FAIR ) + check( RW_BIG_READER ) != 0 ) return EXIT_FAILURE;
+
+    printf( "\n%d readers, %d writes, %.0f ms limit\n", reader_count, writes, limit_ms );
+    printf( "%-18s %13s %14s %14s\n", "policy", "writes", "max wait (ms)", "avg wait (ms)" );
+    run( RW_PREFER_READERS, reader_count, limit_ms * 1e6 );
+    run( RW_PREFER_WRITERS, reader_count, limit_ms * 1e6 );
+    run( RW_PHASE_FAIR,     reader_count, limit_ms * 1e6 );
+    run( RW_BIG_READER,     reader_count, limit_ms * 1e6 );
+    return EXIT_SUCCESS;
+}
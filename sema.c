@@ -5,7 +5,10 @@ AUTHOR  : (C) Copyright 2008 by Peter C. Chapin <PChapin@vtc.vsc.edu>
 
 ****************************************************************************/
 
+#include <errno.h>
+#include <limits.h>
 #include "sema.h"
+#include "futex.h"
 
 // Implementation of my semaphore type.
 
@@ -13,35 +16,100 @@ void semaphore_init( semaphore_t *s, int initial_count )
 {
     if( initial_count < 0 ) initial_count = 0;
 
-    s->raw_count = initial_count;
-    pthread_mutex_init( &s->lock, 0 );
-    pthread_cond_init( &s->non_zero, 0 );
+    atomic_init( &s->raw_count, initial_count );
+    atomic_init( &s->waiters, 0 );
+    atomic_init( &s->bulk_waiters, 0 );
 }
 
 
 void semaphore_destroy( semaphore_t *s )
 {
-    pthread_mutex_destroy( &s->lock );
-    pthread_cond_destroy( &s->non_zero );
+    // Nothing to release.
+    (void)s;
+}
+
+
+// Take n permits if they are there. On failure *count holds the value that was seen.
+static int take( semaphore_t *s, unsigned n, unsigned *count )
+{
+    *count = atomic_load_explicit( &s->raw_count, memory_order_relaxed );
+    while( *count >= n ) {
+        if( atomic_compare_exchange_weak_explicit( &s->raw_count, count, *count - n,
+                                                   memory_order_acquire, memory_order_relaxed ) )
+            return 1;
+    }
+    return 0;
+}
+
+
+void semaphore_up_n( semaphore_t *s, unsigned n )
+{
+    atomic_fetch_add( &s->raw_count, n );
+
+    // Somebody waiting for several permits might need more than we just added, in which case
+    // waking only n threads could pass over a thread that can now proceed. So wake everybody.
+    //
+    if( atomic_load( &s->bulk_waiters ) != 0 )
+        futex_wake( &s->raw_count, INT_MAX );
+    else if( atomic_load( &s->waiters ) != 0 )
+        futex_wake( &s->raw_count, n > INT_MAX ? INT_MAX : (int)n );
+}
+
+
+int semaphore_timed_down_n( semaphore_t *s, unsigned n, const struct timespec *deadline )
+{
+    atomic_uint *waiters = ( n > 1 ) ? &s->bulk_waiters : &s->waiters;
+    unsigned     count;
+    int          rc = 0;
+
+    while( !take( s, n, &count ) ) {
+        if( rc == ETIMEDOUT ) return ETIMEDOUT;
+
+        // Announce the wait before looking at the count for the last time. That way either the
+        // up sees us waiting or we see the new count; futex_wait returns at once if it changed.
+        //
+        atomic_fetch_add( waiters, 1 );
+        count = atomic_load( &s->raw_count );
+        if( count < n ) rc = futex_wait( &s->raw_count, count, deadline );
+        atomic_fetch_sub( waiters, 1 );
+    }
+    return 0;
+}
+
+
+int semaphore_try_down_n( semaphore_t *s, unsigned n )
+{
+    unsigned count;
+
+    return take( s, n, &count ) ? 0 : EAGAIN;
+}
+
+
+void semaphore_down_n( semaphore_t *s, unsigned n )
+{
+    semaphore_timed_down_n( s, n, NULL );
 }
 
 
 void semaphore_up( semaphore_t *s )
 {
-    pthread_mutex_lock( &s->lock );
-    s->raw_count++;
-    pthread_mutex_unlock( &s->lock );
-    pthread_cond_signal( &s->non_zero );
+    semaphore_up_n( s, 1 );
 }
 
 
-void semaphore_down( semaphore_t *s )
+int semaphore_try_down( semaphore_t *s )
 {
-    pthread_mutex_lock( &s->lock );
-    while( s->raw_count == 0 )
-        pthread_cond_wait( &s->non_zero, &s->lock );
+    return semaphore_try_down_n( s, 1 );
+}
 
-    s->raw_count--;
-    pthread_mutex_unlock( &s->lock );
+
+int semaphore_timed_down( semaphore_t *s, const struct timespec *deadline )
+{
+    return semaphore_timed_down_n( s, 1, deadline );
 }
 
+
+void semaphore_down( semaphore_t *s )
+{
+    semaphore_timed_down_n( s, 1, NULL );
+}
@@ -4,18 +4,24 @@ SUBJECT : Interface to semaphore abstract type.
 AUTHOR  : (C) Copyright 2012 by Peter C. Chapin <PChapin@vtc.vsc.edu>
 
 This header file specifies the interface to a semphore abstract type.
+
+The count is an atomic integer. When the count is large enough a down
+operation is just one atomic compare-and-swap, and an up operation is one
+atomic add. Only threads that actually have to wait go into the kernel (by
+way of a futex) and an up only makes a system call if somebody is waiting.
 ****************************************************************************/
 
 #ifndef SEMA_H
 #define SEMA_H
 
-#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
 
 // This is our semaphore type.
 typedef struct {
-    pthread_mutex_t lock;
-    pthread_cond_t  non_zero;
-    int             raw_count;
+    atomic_uint raw_count;
+    atomic_uint waiters;       // Threads waiting for a single permit.
+    atomic_uint bulk_waiters;  // Threads waiting for more than one permit.
 } semaphore_t;
 
 void semaphore_init( semaphore_t *s, int initial_count );
@@ -23,4 +29,17 @@ void semaphore_destroy( semaphore_t *s );
 void semaphore_up( semaphore_t *s );
 void semaphore_down( semaphore_t *s );
 
+// Add or remove n permits at once. A single up_n can release several waiting threads.
+void semaphore_up_n( semaphore_t *s, unsigned n );
+void semaphore_down_n( semaphore_t *s, unsigned n );
+
+// Returns 0 if the count was decremented, otherwise EAGAIN.
+int  semaphore_try_down( semaphore_t *s );
+int  semaphore_try_down_n( semaphore_t *s, unsigned n );
+
+// Returns 0 if the count was decremented or ETIMEDOUT if the deadline (an absolute
+// CLOCK_MONOTONIC time) passed first. A NULL deadline waits forever.
+int  semaphore_timed_down( semaphore_t *s, const struct timespec *deadline );
+int  semaphore_timed_down_n( semaphore_t *s, unsigned n, const struct timespec *deadline );
+
 #endif
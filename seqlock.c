@@ -0,0 +1,92 @@
+/****************************************************************************
+FILE          : seqlock.c
+SUBJECT       : Implementation of a sequence lock.
+PROGRAMMER    : (C) Copyright 2026 by Peter C. Chapin <pcc482719@gmail.com>
+
+The orderings follow the usual fence based recipe. A reader loads the
+sequence with acquire, copies the data and then issues an acquire fence
+before loading the sequence again, so the copy can't be moved after the
+second load. A writer makes the sequence odd, issues a release fence so
+the odd value is visible before any of the new data, and makes it even
+again with a release store once the data is in place.
+
+Strictly speaking the reader's copy races with the writer. The copy is
+made with memcpy into private storage and thrown away when the sequence
+changed, which is how sequence locks are used in practice.
+****************************************************************************/
+
+#include <sched.h>
+#include <string.h>
+#include "seqlock.h"
+
+#define READ_SPINS 100  // Polls of an odd sequence before a reader starts yielding.
+
+void seqlock_init( seqlock_t *s )
+{
+    atomic_init( &s->sequence, 0 );
+    pthread_mutex_init( &s->writer, NULL );
+}
+
+
+void seqlock_destroy( seqlock_t *s )
+{
+    pthread_mutex_destroy( &s->writer );
+}
+
+
+unsigned seqlock_read_begin( seqlock_t *s )
+{
+    unsigned start;
+    int      spins = 0;
+
+    // There is no point copying while a writer is active. It might be preempted, so don't spin forever.
+    while( ( start = atomic_load_explicit( &s->sequence, memory_order_acquire ) ) & 1 ) {
+        if( ++spins > READ_SPINS ) sched_yield( );
+    }
+    return start;
+}
+
+
+int seqlock_read_retry( seqlock_t *s, unsigned start )
+{
+    atomic_thread_fence( memory_order_acquire );
+    return atomic_load_explicit( &s->sequence, memory_order_relaxed ) != start;
+}
+
+
+void seqlock_write_lock( seqlock_t *s )
+{
+    pthread_mutex_lock( &s->writer );
+    atomic_store_explicit( &s->sequence,
+                           atomic_load_explicit( &s->sequence, memory_order_relaxed ) + 1,
+                           memory_order_relaxed );
+    atomic_thread_fence( memory_order_release );
+}
+
+
+void seqlock_write_unlock( seqlock_t *s )
+{
+    atomic_store_explicit( &s->sequence,
+                           atomic_load_explicit( &s->sequence, memory_order_relaxed ) + 1,
+                           memory_order_release );
+    pthread_mutex_unlock( &s->writer );
+}
+
+
+void seqlock_read( seqlock_t *s, void *destination, const void *shared, size_t size )
+{
+    unsigned start;
+
+    do {
+        start = seqlock_read_begin( s );
+        memcpy( destination, shared, size );
+    } while( seqlock_read_retry( s, start ) );
+}
+
+
+void seqlock_write( seqlock_t *s, void *shared, const void *source, size_t size )
+{
+    seqlock_write_lock( s );
+    memcpy( shared, source, size );
+    seqlock_write_unlock( s );
+}
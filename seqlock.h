@@ -0,0 +1,52 @@
+/****************************************************************************
+FILE          : seqlock.h
+SUBJECT       : Interface to a sequence lock.
+PROGRAMMER    : (C) Copyright 2026 by Peter C. Chapin <pcc482719@gmail.com>
+
+A sequence lock protects a small piece of data that is read often and
+written rarely, such as a configuration snapshot or a set of counters.
+Writers are serialized by a mutex and bump a sequence number before and
+after they change the data, so it is odd while a write is in progress.
+Readers take no lock at all. They note the sequence number, read the data
+and check the number again; if it changed (or was odd) they read again.
+Unlike read_lock in rwlock.h, a reader never writes to memory other threads
+use, so any number of readers can run at full speed.
+
+A read section may see the data half written. Readers must only copy the
+data and must not follow pointers in it or act on it until
+seqlock_read_retry says the copy is good. seqlock_read and seqlock_write
+do the whole job for a plain struct:
+
+    seqlock_read( &lock, &my_copy, &shared, sizeof( shared ) );
+
+Readers can be held off indefinitely by a steady stream of writers.
+****************************************************************************/
+
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include "cache_line.h"
+
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) atomic_uint sequence;  // Odd while a writer is active.
+    pthread_mutex_t writer;
+} seqlock_t;
+
+void     seqlock_init( seqlock_t *s );
+void     seqlock_destroy( seqlock_t *s );
+
+// A read section: do { start = seqlock_read_begin( s ); ...copy... } while( seqlock_read_retry( s, start ) );
+unsigned seqlock_read_begin( seqlock_t *s );
+int      seqlock_read_retry( seqlock_t *s, unsigned start );
+
+void     seqlock_write_lock( seqlock_t *s );
+void     seqlock_write_unlock( seqlock_t *s );
+
+// Copy size bytes of protected data out of (into) shared storage as one consistent snapshot.
+void     seqlock_read( seqlock_t *s, void *destination, const void *shared, size_t size );
+void     seqlock_write( seqlock_t *s, void *shared, const void *source, size_t size );
+
+#endif
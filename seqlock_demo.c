@@ -0,0 +1,137 @@
+/****************************************************************************
+FILE          : seqlock_demo.c
+SUBJECT       : Check that seqlock readers never see a torn snapshot.
+PROGRAMMER    : (C) Copyright 2026 by Peter C. Chapin <pcc482719@gmail.com>
+
+A writer thread keeps replacing a small "configuration" struct whose fields
+are all derived from one version number. Several reader threads copy the
+struct out with seqlock_read and check that the fields agree with each
+other. Any disagreement means a reader accepted a half written copy. At
+the end the program prints how many snapshots were read and how many
+times a reader had to try again.
+
+Usage: seqlock_demo [readers [milliseconds]]
+
+Build with:
+  gcc -O2 -pthread -o seqlock_demo seqlock_demo.c seqlock.c
+****************************************************************************/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "seqlock.h"
+
+typedef struct {
+    long version;
+    long timeout;     // Always version * 3.
+    long limit;       // Always version * 5.
+    char name[40];    // Always "config" followed by the version.
+} config_t;
+
+static seqlock_t  lock;
+static config_t   config;
+static atomic_int stop;
+static atomic_long snapshots;
+static atomic_long retries;
+static atomic_long torn;
+
+
+static void make_config( config_t *c, long version )
+{
+    c->version = version;
+    c->timeout = version * 3;
+    c->limit   = version * 5;
+    snprintf( c->name, sizeof( c->name ), "config%ld", version );
+}
+
+
+static void *writer( void *arg )
+{
+    config_t next;
+    long     version = 0;
+
+    (void)arg;
+    while( !atomic_load( &stop ) ) {
+        make_config( &next, ++version );
+        seqlock_write( &lock, &config, &next, sizeof( config ) );
+    }
+    return NULL;
+}
+
+
+static void *reader( void *arg )
+{
+    config_t copy;
+    config_t expected;
+    unsigned start;
+    long     count = 0;
+    long     tries = 0;
+    long     bad   = 0;
+
+    (void)arg;
+    while( !atomic_load( &stop ) ) {
+        // Written out by hand instead of using seqlock_read so the retries can be counted.
+        for( ;; ) {
+            start = seqlock_read_begin( &lock );
+            copy  = config;
+            if( !seqlock_read_retry( &lock, start ) ) break;
+            ++tries;
+        }
+        make_config( &expected, copy.version );
+        if( copy.timeout != expected.timeout || copy.limit != expected.limit ||
+            memcmp( copy.name, expected.name, sizeof( copy.name ) ) != 0 ) ++bad;
+        ++count;
+    }
+    atomic_fetch_add( &snapshots, count );
+    atomic_fetch_add( &retries, tries );
+    atomic_fetch_add( &torn, bad );
+    return NULL;
+}
+
+
+int main( int argc, char **argv )
+{
+    int             reader_count = 4;
+    long            milliseconds = 1000;
+    pthread_t      *IDs;
+    pthread_t       writer_ID;
+    struct timespec duration;
+    int             i;
+
+    if( argc > 1 ) reader_count = atoi( argv[1] );
+    if( argc > 2 ) milliseconds = atol( argv[2] );
+    if( reader_count < 1 || milliseconds < 1 ) {
+        fprintf( stderr, "Usage: %s [readers [milliseconds]]\n", argv[0] );
+        return EXIT_FAILURE;
+    }
+    IDs = malloc( reader_count * sizeof( pthread_t ) );
+    seqlock_init( &lock );
+    make_config( &config, 0 );
+
+    pthread_create( &writer_ID, NULL, writer, NULL );
+    for( i = 0; i < reader_count; ++i ) {
+        pthread_create( &IDs[i], NULL, reader, NULL );
+    }
+    duration.tv_sec  = milliseconds / 1000;
+    duration.tv_nsec = ( milliseconds % 1000 ) * 1000000L;
+    nanosleep( &duration, NULL );
+    atomic_store( &stop, 1 );
+
+    pthread_join( writer_ID, NULL );
+    for( i = 0; i < reader_count; ++i ) {
+        pthread_join( IDs[i], NULL );
+    }
+    seqlock_destroy( &lock );
+    free( IDs );
+
+    printf( "Snapshots read: %ld\n", atomic_load( &snapshots ) );
+    printf( "Retries:        %ld\n", atomic_load( &retries ) );
+    printf( "Torn snapshots: %ld\n", atomic_load( &torn ) );
+    return ( atomic_load( &torn ) == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,212 @@
+/****************************************************************************
+FILE    : spsc_ring.c
+SUBJECT : Implementation of a lock free single producer/single consumer ring.
+AUTHOR  : (C) Copyright 2026 by Peter C. Chapin <pcc482719@gmail.com>
+
+****************************************************************************/
+
+#include <errno.h>
+#include <stdlib.h>
+#include "spsc_ring.h"
+#include "futex.h"
+
+#define SPIN_LIMIT 100   // Times to look again before going to sleep.
+
+int spsc_ring_init( spsc_ring_t *p, int capacity )
+{
+    p->capacity = 1;
+    while( (int)p->capacity < capacity && p->capacity < SPSC_RING_MAX ) p->capacity *= 2;
+    p->buffer = malloc( p->capacity * sizeof( void * ) );
+    if( p->buffer == NULL ) return -1;
+
+    atomic_init( &p->head, 0 );
+    atomic_init( &p->tail, 0 );
+    atomic_init( &p->consumer_waiting, 0 );
+    atomic_init( &p->producer_waiting, 0 );
+    p->tail_cache = 0;
+    p->head_cache = 0;
+    return 0;
+}
+
+
+void spsc_ring_destroy( spsc_ring_t *p )
+{
+    free( p->buffer );
+}
+
+
+// Wait until *index differs from value or the deadline passes, storing the new value in *current.
+// Returns 0 or ETIMEDOUT. The flag and the final check are ordered by full fences against the
+// other side's "update index, fence, look at flag" sequence so a wakeup can't be lost.
+//
+static int wait_for_change( atomic_uint *index,
+                            unsigned value,
+                            atomic_uint *waiting,
+                            const struct timespec *deadline,
+                            unsigned *current )
+{
+    int i;
+    int rc = 0;
+
+    for( i = 0; i < SPIN_LIMIT; ++i ) {
+        *current = atomic_load_explicit( index, memory_order_acquire );
+        if( *current != value ) return 0;
+    }
+
+    for( ;; ) {
+        atomic_store_explicit( waiting, 1, memory_order_relaxed );
+        atomic_thread_fence( memory_order_seq_cst );
+        *current = atomic_load_explicit( index, memory_order_acquire );
+        if( *current != value || rc == ETIMEDOUT ) break;
+        rc = futex_wait( index, value, deadline );
+    }
+    atomic_store_explicit( waiting, 0, memory_order_relaxed );
+    return ( *current != value ) ? 0 : ETIMEDOUT;
+}
+
+
+// Make sure the producer has room for at least one item. Returns 0, EAGAIN or ETIMEDOUT.
+static int wait_for_room( spsc_ring_t *p, unsigned tail, int block, const struct timespec *deadline )
+{
+    // Only look at the consumer's index when the cached copy says the ring is full.
+    if( tail - p->head_cache != p->capacity ) return 0;
+    p->head_cache = atomic_load_explicit( &p->head, memory_order_acquire );
+    if( tail - p->head_cache != p->capacity ) return 0;
+    if( !block ) return EAGAIN;
+    return wait_for_change( &p->head, p->head_cache, &p->producer_waiting, deadline, &p->head_cache );
+}
+
+
+// Make sure the consumer has at least one item. Returns 0, EAGAIN or ETIMEDOUT.
+static int wait_for_data( spsc_ring_t *p, unsigned head, int block, const struct timespec *deadline )
+{
+    // Only look at the producer's index when the cached copy says the ring is empty.
+    if( head != p->tail_cache ) return 0;
+    p->tail_cache = atomic_load_explicit( &p->tail, memory_order_acquire );
+    if( head != p->tail_cache ) return 0;
+    if( !block ) return EAGAIN;
+    return wait_for_change( &p->tail, head, &p->consumer_waiting, deadline, &p->tail_cache );
+}
+
+
+// Called after publishing a new index value.
+static void wake_other_side( atomic_uint *index, atomic_uint *waiting )
+{
+    atomic_thread_fence( memory_order_seq_cst );
+    if( atomic_load_explicit( waiting, memory_order_relaxed ) )
+        futex_wake( index, 1 );
+}
+
+
+static int push_one( spsc_ring_t *p, void *incoming, int block, const struct timespec *deadline )
+{
+    unsigned tail = atomic_load_explicit( &p->tail, memory_order_relaxed );
+    int      rc;
+
+    if( ( rc = wait_for_room( p, tail, block, deadline ) ) != 0 ) return rc;
+    p->buffer[tail & ( p->capacity - 1 )] = incoming;
+    atomic_store_explicit( &p->tail, tail + 1, memory_order_release );
+    wake_other_side( &p->tail, &p->consumer_waiting );
+    return 0;
+}
+
+
+static int pop_one( spsc_ring_t *p, void **outgoing, int block, const struct timespec *deadline )
+{
+    unsigned head = atomic_load_explicit( &p->head, memory_order_relaxed );
+    int      rc;
+
+    if( ( rc = wait_for_data( p, head, block, deadline ) ) != 0 ) return rc;
+    *outgoing = p->buffer[head & ( p->capacity - 1 )];
+    atomic_store_explicit( &p->head, head + 1, memory_order_release );
+    wake_other_side( &p->head, &p->producer_waiting );
+    return 0;
+}
+
+
+int spsc_ring_try_push( spsc_ring_t *p, void *incoming )
+{
+    return push_one( p, incoming, 0, NULL );
+}
+
+
+int spsc_ring_timed_push( spsc_ring_t *p, void *incoming, const struct timespec *deadline )
+{
+    return push_one( p, incoming, 1, deadline );
+}
+
+
+int spsc_ring_try_pop( spsc_ring_t *p, void **outgoing )
+{
+    return pop_one( p, outgoing, 0, NULL );
+}
+
+
+int spsc_ring_timed_pop( spsc_ring_t *p, void **outgoing, const struct timespec *deadline )
+{
+    return pop_one( p, outgoing, 1, deadline );
+}
+
+
+void spsc_ring_push( spsc_ring_t *p, void *incoming )
+{
+    spsc_ring_timed_push( p, incoming, NULL );
+}
+
+
+void *spsc_ring_pop( spsc_ring_t *p )
+{
+    void *return_value;
+
+    spsc_ring_timed_pop( p, &return_value, NULL );
+    return return_value;
+}
+
+
+void spsc_ring_push_many( spsc_ring_t *p, void **incoming, int count )
+{
+    unsigned tail = atomic_load_explicit( &p->tail, memory_order_relaxed );
+    unsigned room;
+    int      i;
+
+    while( count > 0 ) {
+        // Only look at the consumer's index when the cached copy says there isn't enough room.
+        room = p->capacity - ( tail - p->head_cache );
+        if( room < (unsigned)count ) {
+            p->head_cache = atomic_load_explicit( &p->head, memory_order_acquire );
+            wait_for_room( p, tail, 1, NULL );
+            room = p->capacity - ( tail - p->head_cache );
+        }
+
+        for( i = 0; i < (int)room && i < count; ++i )
+            p->buffer[( tail + i ) & ( p->capacity - 1 )] = incoming[i];
+        tail     += i;
+        incoming += i;
+        count    -= i;
+        atomic_store_explicit( &p->tail, tail, memory_order_release );
+        wake_other_side( &p->tail, &p->consumer_waiting );
+    }
+}
+
+
+int spsc_ring_pop_many( spsc_ring_t *p, void **outgoing, int max )
+{
+    unsigned head = atomic_load_explicit( &p->head, memory_order_relaxed );
+    unsigned available;
+    int      i;
+
+    // Only look at the producer's index when the cached copy says there isn't enough data.
+    available = p->tail_cache - head;
+    if( available < (unsigned)max ) {
+        p->tail_cache = atomic_load_explicit( &p->tail, memory_order_acquire );
+        wait_for_data( p, head, 1, NULL );
+        available = p->tail_cache - head;
+    }
+
+    for( i = 0; i < (int)available && i < max; ++i )
+        outgoing[i] = p->buffer[( head + i ) & ( p->capacity - 1 )];
+    atomic_store_explicit( &p->head, head + i, memory_order_release );
+    wake_other_side( &p->head, &p->producer_waiting );
+
+    return i;
+}
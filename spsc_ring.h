@@ -0,0 +1,62 @@
+/****************************************************************************
+FILE    : spsc_ring.h
+SUBJECT : Interface to a lock free single producer/single consumer ring.
+AUTHOR  : (C) Copyright 2026 by Peter C. Chapin <pcc482719@gmail.com>
+
+This ring has the same interface as pcbuffer but it only works when exactly
+one thread pushes and exactly one thread pops. In exchange it needs no
+locks. The producer owns the tail index and the consumer owns the head
+index; each lives on its own cache line so the two threads don't fight
+over it. A thread only sleeps (on a futex) when the ring is full or empty.
+****************************************************************************/
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdatomic.h>
+#include <time.h>
+#include "cache_line.h"
+
+#define SPSC_RING_SIZE 8          // A reasonable default capacity.
+#define SPSC_RING_MAX  (1 << 24)  // Largest capacity allowed.
+
+typedef struct {
+    // Fixed after initialization.
+    void   **buffer;
+    unsigned capacity;                            // Always a power of two.
+
+    // Written by the consumer.
+    _Alignas(CACHE_LINE_SIZE) atomic_uint head;   // Next slot to pop.
+    unsigned                  tail_cache;         // Consumer's last view of tail.
+
+    // Written by the producer.
+    _Alignas(CACHE_LINE_SIZE) atomic_uint tail;   // Next slot to push.
+    unsigned                  head_cache;         // Producer's last view of head.
+
+    // Set only while a thread is (about to be) asleep.
+    _Alignas(CACHE_LINE_SIZE) atomic_uint consumer_waiting;
+    _Alignas(CACHE_LINE_SIZE) atomic_uint producer_waiting;
+} spsc_ring_t;
+
+// The capacity is rounded up to a power of two. Returns 0 or -1 if memory runs out.
+int   spsc_ring_init( spsc_ring_t *, int capacity );
+void  spsc_ring_destroy( spsc_ring_t * );
+void  spsc_ring_push( spsc_ring_t *, void * );
+void *spsc_ring_pop( spsc_ring_t * );
+
+// Push all count items, publishing each run of them with a single index update.
+void  spsc_ring_push_many( spsc_ring_t *, void **, int count );
+
+// Wait for at least one item and then take up to max items. Returns the number taken.
+int   spsc_ring_pop_many( spsc_ring_t *, void **, int max );
+
+// These return 0 on success. The try functions return EAGAIN instead of blocking. The timed
+// functions return ETIMEDOUT once the deadline, an absolute CLOCK_MONOTONIC time, has passed.
+// A NULL deadline waits forever.
+//
+int   spsc_ring_try_push( spsc_ring_t *, void * );
+int   spsc_ring_try_pop( spsc_ring_t *, void ** );
+int   spsc_ring_timed_push( spsc_ring_t *, void *, const struct timespec *deadline );
+int   spsc_ring_timed_pop( spsc_ring_t *, void **, const struct timespec *deadline );
+
+#endif
@@ -0,0 +1,203 @@
+/****************************************************************************
+FILE    : thread_pool.c
+SUBJECT : Implementation of a boss/worker thread pool.
+AUTHOR  : (C) Copyright 2026 by Peter C. Chapin <pcc482719@gmail.com>
+
+The queue carries the futures themselves; a future remembers the task it
+stands for. Shutdown pushes one NULL "poison pill" per worker behind the
+tasks already queued. Before doing so it waits for submitters that have
+already passed the closed check, so no task can land behind the pills and
+be left unfinished.
+****************************************************************************/
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include "thread_pool.h"
+
+typedef enum { PENDING, RUNNING, DONE, CANCELLED } future_state_t;
+
+struct thread_pool_future {
+    thread_pool_task_t task;
+    void              *arg;
+    void              *result;
+    future_state_t     state;
+    atomic_int         references;
+    pthread_mutex_t    lock;
+    pthread_cond_t     finished;
+};
+
+
+static void finish( thread_pool_future_t *future, future_state_t state, void *result )
+{
+    pthread_mutex_lock( &future->lock );
+    future->state  = state;
+    future->result = result;
+    pthread_cond_broadcast( &future->finished );
+    pthread_mutex_unlock( &future->lock );
+}
+
+
+static void *worker( void *arg )
+{
+    thread_pool_t        *pool = arg;
+    thread_pool_future_t *future;
+    int                   immediate;
+    int                   run;
+
+    while( ( future = bounded_buffer_pop( &pool->tasks ) ) != NULL ) {
+        pthread_mutex_lock( &pool->lock );
+        immediate = pool->immediate;
+        pthread_mutex_unlock( &pool->lock );
+
+        // A task cancelled while it waited in the queue is skipped.
+        run = 0;
+        pthread_mutex_lock( &future->lock );
+        if( future->state == PENDING ) {
+            if( immediate ) {
+                future->state = CANCELLED;
+                pthread_cond_broadcast( &future->finished );
+            }
+            else {
+                future->state = RUNNING;
+                run = 1;
+            }
+        }
+        pthread_mutex_unlock( &future->lock );
+
+        if( run ) finish( future, DONE, future->task( future->arg ) );
+        thread_pool_future_release( future );
+    }
+    return NULL;
+}
+
+
+int thread_pool_init( thread_pool_t *pool, int worker_count, int queue_capacity )
+{
+    int i;
+
+    pool->worker_count = 0;
+    pool->workers      = malloc( worker_count * sizeof( pthread_t ) );
+    if( pool->workers == NULL ) return -1;
+    if( bounded_buffer_init( &pool->tasks, queue_capacity ) != 0 ) {
+        free( pool->workers );
+        return -1;
+    }
+    pthread_mutex_init( &pool->lock, NULL );
+    pthread_cond_init( &pool->submitters_done, NULL );
+    pool->closed     = 0;
+    pool->immediate  = 0;
+    pool->submitting = 0;
+
+    for( i = 0; i < worker_count; ++i ) {
+        if( pthread_create( &pool->workers[i], NULL, worker, pool ) != 0 ) {
+            thread_pool_shutdown( pool, THREAD_POOL_IMMEDIATE );
+            return -1;
+        }
+        pool->worker_count++;
+    }
+    return 0;
+}
+
+
+void thread_pool_shutdown( thread_pool_t *pool, thread_pool_shutdown_t how )
+{
+    int i;
+
+    pthread_mutex_lock( &pool->lock );
+    pool->closed = 1;
+    if( how == THREAD_POOL_IMMEDIATE ) pool->immediate = 1;
+    while( pool->submitting > 0 )
+        pthread_cond_wait( &pool->submitters_done, &pool->lock );
+    pthread_mutex_unlock( &pool->lock );
+
+    for( i = 0; i < pool->worker_count; ++i ) {
+        bounded_buffer_push( &pool->tasks, NULL );
+    }
+    for( i = 0; i < pool->worker_count; ++i ) {
+        pthread_join( pool->workers[i], NULL );
+    }
+
+    bounded_buffer_destroy( &pool->tasks );
+    pthread_mutex_destroy( &pool->lock );
+    pthread_cond_destroy( &pool->submitters_done );
+    free( pool->workers );
+}
+
+
+thread_pool_future_t *thread_pool_submit( thread_pool_t *pool, thread_pool_task_t task, void *arg )
+{
+    thread_pool_future_t *future;
+
+    pthread_mutex_lock( &pool->lock );
+    if( pool->closed ) {
+        pthread_mutex_unlock( &pool->lock );
+        return NULL;
+    }
+    pool->submitting++;
+    pthread_mutex_unlock( &pool->lock );
+
+    future = malloc( sizeof( thread_pool_future_t ) );
+    if( future != NULL ) {
+        future->task   = task;
+        future->arg    = arg;
+        future->result = NULL;
+        future->state  = PENDING;
+        atomic_init( &future->references, 2 );  // One for the submitter and one for the pool.
+        pthread_mutex_init( &future->lock, NULL );
+        pthread_cond_init( &future->finished, NULL );
+
+        // This is where back pressure comes from.
+        bounded_buffer_push( &pool->tasks, future );
+    }
+
+    pthread_mutex_lock( &pool->lock );
+    pool->submitting--;
+    if( pool->submitting == 0 && pool->closed ) pthread_cond_signal( &pool->submitters_done );
+    pthread_mutex_unlock( &pool->lock );
+    return future;
+}
+
+
+int thread_pool_future_get( thread_pool_future_t *future, void **result )
+{
+    int status = 0;
+
+    pthread_mutex_lock( &future->lock );
+    while( future->state == PENDING || future->state == RUNNING )
+        pthread_cond_wait( &future->finished, &future->lock );
+    if( future->state == CANCELLED )
+        status = ECANCELED;
+    else if( result != NULL )
+        *result = future->result;
+    pthread_mutex_unlock( &future->lock );
+    return status;
+}
+
+
+int thread_pool_future_cancel( thread_pool_future_t *future )
+{
+    int status = EBUSY;
+
+    pthread_mutex_lock( &future->lock );
+    if( future->state == PENDING ) {
+        future->state = CANCELLED;
+        pthread_cond_broadcast( &future->finished );
+        status = 0;
+    }
+    else if( future->state == CANCELLED ) {
+        status = 0;
+    }
+    pthread_mutex_unlock( &future->lock );
+    return status;
+}
+
+
+void thread_pool_future_release( thread_pool_future_t *future )
+{
+    if( atomic_fetch_sub( &future->references, 1 ) == 1 ) {
+        pthread_mutex_destroy( &future->lock );
+        pthread_cond_destroy( &future->finished );
+        free( future );
+    }
+}
@@ -0,0 +1,64 @@
+/****************************************************************************
+FILE    : thread_pool.h
+SUBJECT : Interface to a boss/worker thread pool.
+AUTHOR  : (C) Copyright 2026 by Peter C. Chapin <pcc482719@gmail.com>
+
+A fixed set of worker threads takes tasks (a function and an argument) from
+a bounded buffer. The buffer's capacity limits how much work can be waiting,
+so a boss that submits faster than the workers can keep up is blocked in
+thread_pool_submit until there is room.
+
+Each submission returns a future that eventually holds the task's result.
+Futures are reference counted: the pool keeps one reference until the task
+has been run or cancelled and the submitter owns the other, which it gives
+up with thread_pool_future_release whether or not it ever looks at the
+result.
+
+Shutting the pool down stops new submissions and waits for the workers to
+exit. A graceful shutdown runs every task already submitted; an immediate
+one cancels the tasks that haven't started. Running tasks always finish.
+****************************************************************************/
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <pthread.h>
+#include "bounded_buffer.h"
+
+typedef void *(*thread_pool_task_t)( void *arg );
+
+typedef enum { THREAD_POOL_GRACEFUL, THREAD_POOL_IMMEDIATE } thread_pool_shutdown_t;
+
+// The members of a future are private to thread_pool.c.
+typedef struct thread_pool_future thread_pool_future_t;
+
+typedef struct {
+    int              worker_count;
+    pthread_t       *workers;
+    bounded_buffer_t tasks;          // Holds futures; a NULL tells a worker to exit.
+    pthread_mutex_t  lock;           // Protects the members below.
+    pthread_cond_t   submitters_done;
+    int              closed;         // Set once shutdown has started.
+    int              immediate;      // Cancel queued tasks instead of running them.
+    int              submitting;     // Submitters between the closed check and their push.
+} thread_pool_t;
+
+// Returns 0 or -1 if the threads or memory can't be had.
+int  thread_pool_init( thread_pool_t *pool, int worker_count, int queue_capacity );
+
+// Stops new submissions, waits for the workers to exit and releases the pool's resources.
+void thread_pool_shutdown( thread_pool_t *pool, thread_pool_shutdown_t how );
+
+// Blocks while the queue is full. Returns NULL if the pool is shutting down or memory runs out.
+thread_pool_future_t *thread_pool_submit( thread_pool_t *pool, thread_pool_task_t task, void *arg );
+
+// Waits for the task. Returns 0 and stores the task's return value in *result (if result
+// isn't NULL), or returns ECANCELED if the task was cancelled before it started.
+int  thread_pool_future_get( thread_pool_future_t *future, void **result );
+
+// Returns 0 if the task was cancelled before it started, or EBUSY if it is running or done.
+int  thread_pool_future_cancel( thread_pool_future_t *future );
+
+void thread_pool_future_release( thread_pool_future_t *future );
+
+#endif
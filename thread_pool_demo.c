@@ -0,0 +1,136 @@
+/****************************************************************************
+FILE          : thread_pool_demo.c
+SUBJECT       : Test program to exercise thread_pool_t.
+PROGRAMMER    : (C) Copyright 2026 by Peter C. Chapin <pcc482719@gmail.com>
+
+The boss (main) hands the pool a stream of small tasks, each of which counts
+the primes in a range of integers, and collects the results through their
+futures. The grand total is checked against a count done without the pool.
+The queue is deliberately small so the boss is held back whenever it gets
+ahead of the workers.
+
+A second round submits more tasks, cancels every other one and then shuts
+the pool down immediately, checking that each future ends up either with a
+correct result or cancelled.
+
+Compile with -DBOUNDED_BUFFER_MPMC and link with mpmc_queue.c to run the
+pool on the lock free queue instead of the monitor version.
+****************************************************************************/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "thread_pool.h"
+
+#define WORKER_COUNT   4
+#define QUEUE_CAPACITY 8
+#define TASK_COUNT     200
+#define RANGE_SIZE     5000   // Integers examined by each task.
+
+static long expected[TASK_COUNT];
+
+
+static int is_prime( long n )
+{
+    long d;
+
+    if( n < 2 ) return 0;
+    for( d = 2; d * d <= n; ++d ) {
+        if( n % d == 0 ) return 0;
+    }
+    return 1;
+}
+
+
+// The argument is the index of a range. Returns the number of primes in it.
+static void *count_primes( void *arg )
+{
+    long start = (long)arg * RANGE_SIZE;
+    long count = 0;
+    long n;
+
+    for( n = start; n < start + RANGE_SIZE; ++n ) count += is_prime( n );
+    return (void *)count;
+}
+
+
+int main( void )
+{
+    thread_pool_t         pool;
+    thread_pool_future_t *futures[TASK_COUNT];
+    void                 *result;
+    long                  total          = 0;
+    long                  expected_total = 0;
+    int                   finished       = 0;
+    int                   cancelled      = 0;
+    int                   errors         = 0;
+    long                  i;
+
+    for( i = 0; i < TASK_COUNT; ++i ) {
+        expected[i] = (long)count_primes( (void *)i );
+        expected_total += expected[i];
+    }
+
+    // Round one: everything runs.
+    if( thread_pool_init( &pool, WORKER_COUNT, QUEUE_CAPACITY ) != 0 ) {
+        fprintf( stderr, "Unable to create the thread pool\n" );
+        return EXIT_FAILURE;
+    }
+    for( i = 0; i < TASK_COUNT; ++i ) {
+        futures[i] = thread_pool_submit( &pool, count_primes, (void *)i );
+    }
+    for( i = 0; i < TASK_COUNT; ++i ) {
+        if( futures[i] == NULL || thread_pool_future_get( futures[i], &result ) != 0 ) {
+            ++errors;
+            continue;
+        }
+        total += (long)result;
+        thread_pool_future_release( futures[i] );
+    }
+    thread_pool_shutdown( &pool, THREAD_POOL_GRACEFUL );
+    printf( "Primes found: %ld (expected %ld)\n", total, expected_total );
+    if( total != expected_total ) ++errors;
+
+    // Round two: cancel half, then stop immediately.
+    if( thread_pool_init( &pool, WORKER_COUNT, TASK_COUNT ) != 0 ) {
+        fprintf( stderr, "Unable to create the thread pool\n" );
+        return EXIT_FAILURE;
+    }
+    for( i = 0; i < TASK_COUNT; ++i ) {
+        futures[i] = thread_pool_submit( &pool, count_primes, (void *)i );
+    }
+    for( i = 0; i < TASK_COUNT; i += 2 ) {
+        if( futures[i] != NULL ) thread_pool_future_cancel( futures[i] );
+    }
+    thread_pool_shutdown( &pool, THREAD_POOL_IMMEDIATE );
+
+    for( i = 0; i < TASK_COUNT; ++i ) {
+        if( futures[i] == NULL ) {
+            ++errors;
+            continue;
+        }
+        switch( thread_pool_future_get( futures[i], &result ) ) {
+        case 0:
+            ++finished;
+            if( (long)result != expected[i] ) ++errors;
+            break;
+        case ECANCELED:
+            ++cancelled;
+            break;
+        default:
+            ++errors;
+            break;
+        }
+        thread_pool_future_release( futures[i] );
+    }
+    printf( "After immediate shutdown: %d finished, %d cancelled\n", finished, cancelled );
+    if( finished + cancelled != TASK_COUNT ) ++errors;
+
+    if( errors != 0 ) {
+        printf( "%d errors!\n", errors );
+        return EXIT_FAILURE;
+    }
+    printf( "No errors\n" );
+    return EXIT_SUCCESS;
+}
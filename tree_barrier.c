@@ -0,0 +1,89 @@
+/****************************************************************************
+FILE          : tree_barrier.c
+SUBJECT       : Implementation of a combining tree barrier.
+PROGRAMMER    : (C) Copyright 2026 by Peter C. Chapin <pcc482719@gmail.com>
+
+****************************************************************************/
+
+#include <sched.h>
+#include <stdlib.h>
+#include "tree_barrier.h"
+
+#define SPIN_LIMIT 1000   // Checks between calls to sched_yield.
+
+int tree_barrier_init( tree_barrier_t *b, int threads )
+{
+    int level_start = 0;
+    int level_size;
+    int node_count;
+    int n;
+    int i;
+
+    if( threads < 1 ) threads = 1;
+    b->threads = threads;
+
+    // Count the nodes: each level has 1/FANIN as many as the one below it.
+    node_count = 0;
+    for( n = threads; ; n = level_size ) {
+        level_size  = ( n + TREE_BARRIER_FANIN - 1 ) / TREE_BARRIER_FANIN;
+        node_count += level_size;
+        if( level_size == 1 ) break;
+    }
+    b->nodes = aligned_alloc( CACHE_LINE_SIZE, node_count * sizeof( tree_barrier_node_t ) );
+    if( b->nodes == NULL ) return -1;
+
+    // Build the tree level by level. The n things below a level report to it in groups of FANIN.
+    for( n = threads; ; n = level_size ) {
+        level_size = ( n + TREE_BARRIER_FANIN - 1 ) / TREE_BARRIER_FANIN;
+        for( i = 0; i < level_size; ++i ) {
+            tree_barrier_node_t *node = &b->nodes[level_start + i];
+
+            atomic_init( &node->count, 0 );
+            atomic_init( &node->phase, 0 );
+            node->expected = ( i == level_size - 1 ) ? n - i * TREE_BARRIER_FANIN : TREE_BARRIER_FANIN;
+            node->parent   = ( level_size == 1 ) ? NULL :
+                             &b->nodes[level_start + level_size + i / TREE_BARRIER_FANIN];
+        }
+        if( level_size == 1 ) break;
+        level_start += level_size;
+    }
+    return 0;
+}
+
+
+void tree_barrier_destroy( tree_barrier_t *b )
+{
+    free( b->nodes );
+}
+
+
+static int arrive( tree_barrier_node_t *node )
+{
+    unsigned local_sense = atomic_load_explicit( &node->phase, memory_order_acquire );
+    int      serial;
+    int      spins = 0;
+
+    // The last to arrive represents this node at the parent. Once the parent releases it, it
+    // resets this node and releases the threads that are waiting here.
+    //
+    if( atomic_fetch_add_explicit( &node->count, 1, memory_order_acq_rel ) + 1 == node->expected ) {
+        serial = ( node->parent == NULL ) ? BARRIER_SERIAL_THREAD : arrive( node->parent );
+        atomic_store_explicit( &node->count, 0, memory_order_relaxed );
+        atomic_store_explicit( &node->phase, local_sense + 1, memory_order_release );
+        return serial;
+    }
+
+    while( atomic_load_explicit( &node->phase, memory_order_acquire ) == local_sense ) {
+        if( ++spins == SPIN_LIMIT ) {
+            spins = 0;
+            sched_yield( );
+        }
+    }
+    return 0;
+}
+
+
+int tree_barrier_wait( tree_barrier_t *b, int id )
+{
+    return arrive( &b->nodes[id / TREE_BARRIER_FANIN] );
+}
@@ -0,0 +1,47 @@
+/****************************************************************************
+FILE          : tree_barrier.h
+SUBJECT       : Interface to a combining tree barrier.
+PROGRAMMER    : (C) Copyright 2026 by Peter C. Chapin <pcc482719@gmail.com>
+
+With many threads a single arrival counter becomes a hot spot; every
+arriving thread has to pull the same cache line over. This barrier spreads
+the arrivals over a tree of counters with TREE_BARRIER_FANIN children per
+node. The last thread to reach a node goes on to its parent, and the
+thread that completes the root starts the release, which flows back down
+the tree. Every node's counter and release word sits on its own cache line.
+
+Threads must identify themselves with a distinct id from 0 to threads - 1;
+that decides which leaf they report to. Waiting threads spin, yielding the
+processor now and then, so this barrier is intended for machines with at
+least as many cores as threads.
+****************************************************************************/
+
+#ifndef TREE_BARRIER_H
+#define TREE_BARRIER_H
+
+#include <stdatomic.h>
+#include "barrier.h"
+#include "cache_line.h"
+
+#define TREE_BARRIER_FANIN 4
+
+typedef struct tree_barrier_node {
+    _Alignas(CACHE_LINE_SIZE) atomic_uint count;  // Arrivals at this node.
+    unsigned                  expected;           // Threads or child nodes that report here.
+    struct tree_barrier_node *parent;             // NULL at the root.
+    _Alignas(CACHE_LINE_SIZE) atomic_uint phase;  // Advanced to release this node's waiters.
+} tree_barrier_node_t;
+
+typedef struct {
+    int                  threads;
+    tree_barrier_node_t *nodes;     // The leaves come first and the root is last.
+} tree_barrier_t;
+
+// Returns 0 or -1 if memory runs out.
+int  tree_barrier_init( tree_barrier_t *b, int threads );
+void tree_barrier_destroy( tree_barrier_t *b );
+
+// Returns BARRIER_SERIAL_THREAD in the thread that completed the root and zero in the others.
+int  tree_barrier_wait( tree_barrier_t *b, int id );
+
+#endif
@@ -0,0 +1,205 @@
+/****************************************************************************
+FILE    : uring.c
+SUBJECT : Implementation of a minimal io_uring wrapper.
+AUTHOR  : (C) Copyright 2026 by Peter C. Chapin <pcc482719@gmail.com>
+
+The rings are shared with the kernel. Entries must be filled in before the
+tail that publishes them is stored, and a completion must be read before
+the head that releases it is stored, hence the acquire and release
+operations on the indices.
+****************************************************************************/
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include "uring.h"
+
+static int setup( unsigned entries, struct io_uring_params *params )
+{
+    return (int)syscall( __NR_io_uring_setup, entries, params );
+}
+
+
+static int enter( int fd, unsigned to_submit, unsigned min_complete, unsigned flags )
+{
+    return (int)syscall( __NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0 );
+}
+
+
+int uring_init( uring_t *ring, unsigned entries )
+{
+    struct io_uring_params params;
+    unsigned char *sq;
+    unsigned char *cq;
+
+    memset( ring, 0, sizeof( uring_t ) );
+    memset( &params, 0, sizeof( params ) );
+    if( ( ring->fd = setup( entries, &params ) ) == -1 ) return -1;
+
+    // Plain reads and writes (rather than readv and writev) arrived with this feature.
+    if( !( params.features & IORING_FEAT_RW_CUR_POS ) ) {
+        close( ring->fd );
+        errno = EINVAL;
+        return -1;
+    }
+
+    ring->entries      = params.sq_entries;
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof( unsigned );
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof( struct io_uring_cqe );
+    if( params.features & IORING_FEAT_SINGLE_MMAP ) {
+        if( ring->cq_ring_size > ring->sq_ring_size ) ring->sq_ring_size = ring->cq_ring_size;
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+
+    ring->sq_ring = mmap( NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING );
+    if( ring->sq_ring == MAP_FAILED ) goto fail;
+    if( params.features & IORING_FEAT_SINGLE_MMAP ) {
+        ring->cq_ring = ring->sq_ring;
+    }
+    else {
+        ring->cq_ring = mmap( NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING );
+        if( ring->cq_ring == MAP_FAILED ) goto unmap_sq;
+    }
+    ring->sqes_size = params.sq_entries * sizeof( struct io_uring_sqe );
+    ring->sqes = mmap( NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES );
+    if( ring->sqes == MAP_FAILED ) goto unmap_cq;
+
+    sq = ring->sq_ring;
+    cq = ring->cq_ring;
+    ring->sq_head  = (unsigned *)( sq + params.sq_off.head );
+    ring->sq_tail  = (unsigned *)( sq + params.sq_off.tail );
+    ring->sq_mask  = (unsigned *)( sq + params.sq_off.ring_mask );
+    ring->sq_array = (unsigned *)( sq + params.sq_off.array );
+    ring->cq_head  = (unsigned *)( cq + params.cq_off.head );
+    ring->cq_tail  = (unsigned *)( cq + params.cq_off.tail );
+    ring->cq_mask  = (unsigned *)( cq + params.cq_off.ring_mask );
+    ring->cqes     = (struct io_uring_cqe *)( cq + params.cq_off.cqes );
+    return 0;
+
+unmap_cq:
+    if( ring->cq_ring != ring->sq_ring ) munmap( ring->cq_ring, ring->cq_ring_size );
+unmap_sq:
+    munmap( ring->sq_ring, ring->sq_ring_size );
+fail:
+    close( ring->fd );
+    return -1;
+}
+
+
+void uring_destroy( uring_t *ring )
+{
+    munmap( ring->sqes, ring->sqes_size );
+    if( ring->cq_ring != ring->sq_ring ) munmap( ring->cq_ring, ring->cq_ring_size );
+    munmap( ring->sq_ring, ring->sq_ring_size );
+    close( ring->fd );  // Also unregisters the buffers.
+}
+
+
+int uring_register_buffer( uring_t *ring, void *base, size_t size )
+{
+    struct iovec area;
+
+    area.iov_base = base;
+    area.iov_len  = size;
+    if( syscall( __NR_io_uring_register, ring->fd, IORING_REGISTER_BUFFERS, &area, 1 ) == -1 ) {
+        return -1;
+    }
+    ring->fixed = 1;
+    return 0;
+}
+
+
+// Fill in the next submission queue entry. The kernel can't see it until uring_submit.
+static int queue( uring_t *ring, int opcode, int fd, const void *buffer,
+                  unsigned size, off_t offset, void *tag )
+{
+    unsigned tail = *ring->sq_tail;
+    unsigned index;
+    struct io_uring_sqe *sqe;
+
+    // The completion queue is at least as big, so it can't overflow either.
+    if( ring->queued + ring->in_flight >= ring->entries ) return -1;
+
+    index = tail & *ring->sq_mask;
+    sqe = &ring->sqes[index];
+    memset( sqe, 0, sizeof( *sqe ) );
+    sqe->opcode    = ring->fixed ? opcode : ( opcode == IORING_OP_READ_FIXED ? IORING_OP_READ
+                                                                             : IORING_OP_WRITE );
+    sqe->fd        = fd;
+    sqe->off       = offset;
+    sqe->addr      = (unsigned long)buffer;
+    sqe->len       = size;
+    sqe->buf_index = 0;
+    sqe->user_data = (unsigned long)tag;
+    ring->sq_array[index] = index;
+    __atomic_store_n( ring->sq_tail, tail + 1, __ATOMIC_RELEASE );
+    ring->queued++;
+    return 0;
+}
+
+
+int uring_read( uring_t *ring, int fd, void *buffer, unsigned size, off_t offset, void *tag )
+{
+    return queue( ring, IORING_OP_READ_FIXED, fd, buffer, size, offset, tag );
+}
+
+
+int uring_write( uring_t *ring, int fd, const void *buffer, unsigned size, off_t offset, void *tag )
+{
+    return queue( ring, IORING_OP_WRITE_FIXED, fd, buffer, size, offset, tag );
+}
+
+
+// Submit what is queued, optionally waiting for at least one completion.
+static int submit_and_wait( uring_t *ring, unsigned wait )
+{
+    int taken;
+
+    do {
+        taken = enter( ring->fd, ring->queued, wait, wait ? IORING_ENTER_GETEVENTS : 0 );
+    } while( taken == -1 && errno == EINTR );
+    if( taken == -1 ) return -1;
+    ring->queued    -= taken;
+    ring->in_flight += taken;
+    return 0;
+}
+
+
+int uring_submit( uring_t *ring )
+{
+    if( ring->queued == 0 ) return 0;
+    return submit_and_wait( ring, 0 );
+}
+
+
+int uring_ready( uring_t *ring )
+{
+    return *ring->cq_head != __atomic_load_n( ring->cq_tail, __ATOMIC_ACQUIRE );
+}
+
+
+int uring_wait( uring_t *ring, void **tag )
+{
+    unsigned head;
+    struct io_uring_cqe *cqe;
+    int result;
+
+    *tag = NULL;
+    if( ring->queued + ring->in_flight == 0 ) return -ECANCELED;
+    while( !uring_ready( ring ) ) {
+        if( submit_and_wait( ring, 1 ) == -1 ) return -errno;
+    }
+    head   = *ring->cq_head;
+    cqe    = &ring->cqes[head & *ring->cq_mask];
+    *tag   = (void *)(unsigned long)cqe->user_data;
+    result = cqe->res;
+    __atomic_store_n( ring->cq_head, head + 1, __ATOMIC_RELEASE );
+    ring->in_flight--;
+    return result;
+}
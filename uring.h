@@ -0,0 +1,73 @@
+/****************************************************************************
+FILE    : uring.h
+SUBJECT : Interface to a minimal io_uring wrapper.
+AUTHOR  : (C) Copyright 2026 by Peter C. Chapin <pcc482719@gmail.com>
+
+io_uring lets a program queue many I/O requests and collect their results
+later, so a single thread can keep a device busy instead of blocking in
+read() or write() with one request outstanding. The kernel shares two
+rings with the program: a submission queue of requests and a completion
+queue of results. This wrapper talks to the system calls directly so it
+has no dependencies beyond the kernel headers.
+
+A ring must only be used by one thread at a time. Requests on regular
+files use explicit offsets; there is no notion of a current position.
+****************************************************************************/
+
+#ifndef URING_H
+#define URING_H
+
+#include <stddef.h>
+#include <sys/types.h>
+#include <linux/io_uring.h>
+
+typedef struct {
+    int   fd;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void  *sq_ring;
+    void  *cq_ring;          // The same as sq_ring if the kernel maps both at once.
+    size_t sq_ring_size;
+    size_t cq_ring_size;
+    size_t sqes_size;
+    unsigned entries;
+    unsigned queued;         // Requests prepared but not yet submitted.
+    unsigned in_flight;      // Requests submitted whose completions have not been taken.
+    int   fixed;             // Nonzero once buffers are registered.
+} uring_t;
+
+// Set up a ring with room for entries requests. Returns 0 or -1 with errno set. ENOSYS, EPERM
+// or EINVAL mean io_uring can't be used here (too old a kernel, or forbidden) and the caller
+// should fall back to ordinary system calls.
+int  uring_init( uring_t *ring, unsigned entries );
+void uring_destroy( uring_t *ring );
+
+// Register one area of memory for fixed buffer requests. Pinning it saves the kernel mapping
+// the pages for every request. Returns 0 or -1 with errno set (ENOMEM if the area exceeds
+// RLIMIT_MEMLOCK); the ring still works without it.
+int  uring_register_buffer( uring_t *ring, void *base, size_t size );
+
+// Queue a read or write of size bytes at offset. If buffers are registered the buffer must lie
+// within them. The tag comes back with the result. Returns 0 or -1 if the ring is full.
+int  uring_read( uring_t *ring, int fd, void *buffer, unsigned size, off_t offset, void *tag );
+int  uring_write( uring_t *ring, int fd, const void *buffer, unsigned size, off_t offset, void *tag );
+
+// Hand queued requests to the kernel. Returns 0 or -1 with errno set.
+int  uring_submit( uring_t *ring );
+
+// Returns nonzero if a completion is waiting to be taken.
+int  uring_ready( uring_t *ring );
+
+// Submit anything queued and wait for a completion. Stores its tag and returns its result: a
+// byte count or a negated errno value. If nothing is in flight, or the ring itself fails, the
+// tag is set to NULL and the result is -ECANCELED or the negated errno value.
+int  uring_wait( uring_t *ring, void **tag );
+
+#endif
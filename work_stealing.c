@@ -0,0 +1,394 @@
+/****************************************************************************
+FILE    : work_stealing.c
+SUBJECT : Implementation of a work stealing fork/join scheduler.
+AUTHOR  : (C) Copyright 2026 by Peter C. Chapin <pcc482719@gmail.com>
+
+Parking has to avoid the lost wakeup where a worker decides there is no
+work just before a task is pushed and then sleeps through it. A worker
+about to park first adds itself to sleepers, then looks for work once more.
+A spawner first makes its task visible, then looks at sleepers. Both sides
+put a sequentially consistent fence between the two steps, so at least
+one of them sees the other.
+
+Each wakeup is one decrement of sleepers paired with one semaphore_up. A
+worker that finds work after registering takes itself back out of
+sleepers if it still can. If sleepers is already zero, somebody has posted
+a permit meant for it, and it consumes that permit so the count stays
+balanced.
+
+A thread from outside the pool that syncs a group sleeps on the pool's
+synced condition instead. It marks the group by adding WAITING to pending,
+and the task that brings pending down to just WAITING broadcasts. Only
+pending is touched in the group; a worker syncing a group of its own may
+return, and its group go out of scope, the moment pending drops.
+****************************************************************************/
+
+#include <sched.h>
+#include <stdlib.h>
+#include "work_stealing.h"
+
+#define IDLE_SPINS 64  // Unsuccessful rounds of stealing before a worker parks.
+#define WAITING    ( 1L << 48 )  // Added to pending while an outside thread waits on the group.
+
+struct ws_task {
+    ws_task_fn  function;
+    void       *arg;
+    ws_group_t *group;
+    ws_task_t  *next;   // Used only on the inject list.
+};
+
+struct ws_worker {
+    ws_deque_t deque;
+    ws_pool_t *pool;
+    pthread_t  thread;
+    unsigned   random;  // State for choosing victims.
+};
+
+// The worker, if any, that the calling thread is.
+static _Thread_local ws_worker_t *current_worker;
+
+
+static ws_worker_t *self_in( ws_pool_t *pool )
+{
+    if( current_worker != NULL && current_worker->pool == pool ) return current_worker;
+    return NULL;
+}
+
+
+static unsigned next_random( unsigned *state )
+{
+    // xorshift32
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+
+static void run_task( ws_pool_t *pool, ws_task_t *task )
+{
+    ws_group_t *group = task->group;
+
+    task->function( task->arg );
+    free( task );
+    if( atomic_fetch_sub( &group->pending, 1 ) == WAITING + 1 ) {
+        pthread_mutex_lock( &pool->sync_lock );
+        pthread_cond_broadcast( &pool->synced );
+        pthread_mutex_unlock( &pool->sync_lock );
+    }
+}
+
+
+static ws_task_t *take_injected( ws_pool_t *pool )
+{
+    ws_task_t *task = NULL;
+
+    if( atomic_load_explicit( &pool->inject_count, memory_order_relaxed ) == 0 ) return NULL;
+    pthread_mutex_lock( &pool->inject_lock );
+    if( pool->inject_head != NULL ) {
+        task = pool->inject_head;
+        pool->inject_head = task->next;
+        if( pool->inject_head == NULL ) pool->inject_tail = NULL;
+        atomic_fetch_sub( &pool->inject_count, 1 );
+    }
+    pthread_mutex_unlock( &pool->inject_lock );
+    return task;
+}
+
+
+// Try each other worker once, starting at a random one.
+static ws_task_t *steal( ws_pool_t *pool, ws_worker_t *self, unsigned *random )
+{
+    int        start = next_random( random ) % pool->worker_count;
+    int        i;
+    ws_worker_t *victim;
+    ws_task_t  *task;
+
+    for( i = 0; i < pool->worker_count; ++i ) {
+        victim = &pool->workers[( start + i ) % pool->worker_count];
+        if( victim == self ) continue;
+        if( ( task = ws_deque_steal( &victim->deque ) ) != NULL ) return task;
+    }
+    return NULL;
+}
+
+
+static ws_task_t *find_work( ws_pool_t *pool, ws_worker_t *self, unsigned *random )
+{
+    ws_task_t *task;
+
+    if( self != NULL && ( task = ws_deque_take( &self->deque ) ) != NULL ) return task;
+    if( ( task = take_injected( pool ) ) != NULL ) return task;
+    return steal( pool, self, random );
+}
+
+
+static int work_visible( ws_pool_t *pool )
+{
+    int i;
+
+    if( atomic_load( &pool->inject_count ) > 0 ) return 1;
+    for( i = 0; i < pool->worker_count; ++i ) {
+        if( !ws_deque_empty( &pool->workers[i].deque ) ) return 1;
+    }
+    return 0;
+}
+
+
+// Called after new work has been made visible.
+static void wake_one( ws_pool_t *pool )
+{
+    int sleepers;
+
+    atomic_thread_fence( memory_order_seq_cst );
+    sleepers = atomic_load_explicit( &pool->sleepers, memory_order_relaxed );
+    while( sleepers > 0 ) {
+        if( atomic_compare_exchange_weak( &pool->sleepers, &sleepers, sleepers - 1 ) ) {
+            semaphore_up( &pool->idle );
+            return;
+        }
+    }
+}
+
+
+static void park( ws_pool_t *pool )
+{
+    int sleepers;
+
+    atomic_fetch_add( &pool->sleepers, 1 );
+    atomic_thread_fence( memory_order_seq_cst );
+    if( work_visible( pool ) || atomic_load( &pool->stopping ) ) {
+        sleepers = atomic_load( &pool->sleepers );
+        while( sleepers > 0 ) {
+            if( atomic_compare_exchange_weak( &pool->sleepers, &sleepers, sleepers - 1 ) ) return;
+        }
+        // A permit has been posted on our behalf; take it.
+    }
+    semaphore_down( &pool->idle );
+}
+
+
+static void *worker( void *arg )
+{
+    ws_worker_t *self = arg;
+    ws_pool_t   *pool = self->pool;
+    ws_task_t   *task;
+    int          misses = 0;
+
+    current_worker = self;
+    for( ;; ) {
+        if( ( task = find_work( pool, self, &self->random ) ) != NULL ) {
+            run_task( pool, task );
+            misses = 0;
+            continue;
+        }
+        if( atomic_load( &pool->stopping ) ) break;
+        if( ++misses < IDLE_SPINS ) {
+            sched_yield( );
+            continue;
+        }
+        park( pool );
+        misses = 0;
+    }
+    return NULL;
+}
+
+
+// Stop the first count workers and wait for them to finish.
+static void stop_workers( ws_pool_t *pool, int count )
+{
+    int i;
+
+    atomic_store( &pool->stopping, 1 );
+    semaphore_up_n( &pool->idle, count );
+    for( i = 0; i < count; ++i ) {
+        pthread_join( pool->workers[i].thread, NULL );
+    }
+}
+
+
+// Release everything but the threads.
+static void release_pool( ws_pool_t *pool )
+{
+    int i;
+
+    for( i = 0; i < pool->worker_count; ++i ) {
+        ws_deque_destroy( &pool->workers[i].deque );
+    }
+    semaphore_destroy( &pool->idle );
+    pthread_cond_destroy( &pool->synced );
+    pthread_mutex_destroy( &pool->sync_lock );
+    pthread_mutex_destroy( &pool->inject_lock );
+    free( pool->workers );
+}
+
+
+int ws_pool_init( ws_pool_t *pool, int worker_count )
+{
+    int i;
+
+    pool->workers = aligned_alloc( CACHE_LINE_SIZE, worker_count * sizeof( ws_worker_t ) );
+    if( pool->workers == NULL ) return -1;
+    for( i = 0; i < worker_count; ++i ) {
+        if( ws_deque_init( &pool->workers[i].deque, WS_DEQUE_CAPACITY ) != 0 ) {
+            while( --i >= 0 ) ws_deque_destroy( &pool->workers[i].deque );
+            free( pool->workers );
+            return -1;
+        }
+        pool->workers[i].pool   = pool;
+        pool->workers[i].random = 2654435761u * ( i + 1 );
+    }
+    pool->worker_count = worker_count;
+    pthread_mutex_init( &pool->inject_lock, NULL );
+    pool->inject_head = NULL;
+    pool->inject_tail = NULL;
+    atomic_init( &pool->inject_count, 0 );
+    semaphore_init( &pool->idle, 0 );
+    pthread_mutex_init( &pool->sync_lock, NULL );
+    pthread_cond_init( &pool->synced, NULL );
+    atomic_init( &pool->sleepers, 0 );
+    atomic_init( &pool->stopping, 0 );
+
+    for( i = 0; i < worker_count; ++i ) {
+        if( pthread_create( &pool->workers[i].thread, NULL, worker, &pool->workers[i] ) != 0 ) {
+            // The workers already running steal from every deque, so stop them before any goes.
+            stop_workers( pool, i );
+            release_pool( pool );
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+void ws_pool_shutdown( ws_pool_t *pool )
+{
+    stop_workers( pool, pool->worker_count );
+    release_pool( pool );
+}
+
+
+void ws_group_init( ws_group_t *group )
+{
+    atomic_init( &group->pending, 0 );
+}
+
+
+void ws_spawn( ws_pool_t *pool, ws_group_t *group, ws_task_fn function, void *arg )
+{
+    ws_worker_t *self = self_in( pool );
+    ws_task_t   *task = malloc( sizeof( ws_task_t ) );
+
+    // Without memory or room on the deque the task is simply run now.
+    if( task == NULL ) {
+        function( arg );
+        return;
+    }
+    task->function = function;
+    task->arg      = arg;
+    task->group    = group;
+    atomic_fetch_add_explicit( &group->pending, 1, memory_order_relaxed );
+
+    if( self != NULL ) {
+        if( ws_deque_push( &self->deque, task ) != 0 ) {
+            run_task( pool, task );
+            return;
+        }
+    }
+    else {
+        task->next = NULL;
+        pthread_mutex_lock( &pool->inject_lock );
+        if( pool->inject_tail == NULL )
+            pool->inject_head = task;
+        else
+            pool->inject_tail->next = task;
+        pool->inject_tail = task;
+        atomic_fetch_add( &pool->inject_count, 1 );
+        pthread_mutex_unlock( &pool->inject_lock );
+    }
+    wake_one( pool );
+}
+
+
+void ws_sync( ws_pool_t *pool, ws_group_t *group )
+{
+    ws_worker_t *self = self_in( pool );
+    ws_task_t   *task;
+
+    // A thread from outside the pool only sleeps. Every task it ran would spawn onto the shared
+    // list and sync in turn, nesting deeper and deeper on its stack, and spinning would take a
+    // processor from the workers.
+    if( self == NULL ) {
+        if( atomic_fetch_add( &group->pending, WAITING ) == 0 ) {
+            atomic_store( &group->pending, 0 );
+            return;
+        }
+        pthread_mutex_lock( &pool->sync_lock );
+        while( atomic_load( &group->pending ) != WAITING ) {
+            pthread_cond_wait( &pool->synced, &pool->sync_lock );
+        }
+        pthread_mutex_unlock( &pool->sync_lock );
+        atomic_store( &group->pending, 0 );
+        return;
+    }
+
+    // A worker helps with whatever work there is rather than block.
+    while( atomic_load_explicit( &group->pending, memory_order_acquire ) > 0 ) {
+        if( ( task = find_work( pool, self, &self->random ) ) != NULL )
+            run_task( pool, task );
+        else
+            sched_yield( );
+    }
+}
+
+
+typedef struct {
+    ws_pool_t  *pool;
+    long        begin;
+    long        end;
+    long        grain;
+    ws_range_fn body;
+    void       *arg;
+    int         allocated;  // Free the range when done with it.
+} range_t;
+
+// Keep splitting off the upper half for somebody else until the rest is small enough.
+static void range_task( void *arg )
+{
+    range_t   *range = arg;
+    range_t   *upper;
+    ws_group_t group;
+    long       middle;
+
+    ws_group_init( &group );
+    while( range->end - range->begin > range->grain ) {
+        middle = range->begin + ( range->end - range->begin ) / 2;
+        if( ( upper = malloc( sizeof( range_t ) ) ) == NULL ) break;
+        *upper = *range;
+        upper->begin     = middle;
+        upper->allocated = 1;
+        range->end       = middle;
+        ws_spawn( range->pool, &group, range_task, upper );
+    }
+    range->body( range->begin, range->end, range->arg );
+    ws_sync( range->pool, &group );
+    if( range->allocated ) free( range );
+}
+
+
+void ws_parallel_for( ws_pool_t *pool, long begin, long end, long grain, ws_range_fn body, void *arg )
+{
+    range_t    range = { pool, begin, end, ( grain < 1 ) ? 1 : grain, body, arg, 0 };
+    ws_group_t group;
+
+    if( begin >= end ) return;
+    if( self_in( pool ) != NULL ) {
+        range_task( &range );
+        return;
+    }
+
+    // From outside the pool, hand the whole range to a worker.
+    ws_group_init( &group );
+    ws_spawn( pool, &group, range_task, &range );
+    ws_sync( pool, &group );
+}
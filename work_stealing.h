@@ -0,0 +1,79 @@
+/****************************************************************************
+FILE    : work_stealing.h
+SUBJECT : Interface to a work stealing fork/join scheduler.
+AUTHOR  : (C) Copyright 2026 by Peter C. Chapin <pcc482719@gmail.com>
+
+thread_pool_t hands out work through one shared queue, which is fine for
+coarse tasks but becomes the bottleneck when tasks are tiny and spawn more
+tasks, as in divide and conquer algorithms. Here each worker has its own
+deque (see ws_deque.h). A task spawned by a worker goes on that worker's
+deque, the worker runs its newest task first, and a worker that runs out
+of work steals the oldest task of a randomly chosen victim. Workers that
+find nothing to steal sleep on a semaphore_t until new work shows up.
+
+Tasks are spawned into a group and ws_sync waits for every task in the
+group to finish. A thread waiting in ws_sync runs other tasks meanwhile,
+so recursive spawn/sync can't deadlock the pool:
+
+    ws_group_t group;
+
+    ws_group_init( &group );
+    ws_spawn( pool, &group, left_half, left_arg );
+    right_half( right_arg );
+    ws_sync( pool, &group );
+
+Any thread may spawn and sync, though only one thread syncs a given
+group. Threads outside the pool hand their tasks over through a shared
+list, and in ws_sync they sleep until the group is done, so the usual way
+to start is to spawn one root task from outside and sync on it.
+****************************************************************************/
+
+#ifndef WORK_STEALING_H
+#define WORK_STEALING_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include "sema.h"
+#include "ws_deque.h"
+
+#define WS_DEQUE_CAPACITY 4096  // Tasks spawned beyond this are run at once by the spawner.
+
+typedef void (*ws_task_fn)( void *arg );
+typedef void (*ws_range_fn)( long begin, long end, void *arg );
+
+typedef struct {
+    atomic_long pending;  // Tasks spawned into the group that have not finished.
+} ws_group_t;
+
+// The members of a task and a worker are private to work_stealing.c.
+typedef struct ws_task   ws_task_t;
+typedef struct ws_worker ws_worker_t;
+
+typedef struct {
+    int             worker_count;
+    ws_worker_t    *workers;
+    pthread_mutex_t inject_lock;   // Protects the list of tasks spawned from outside the pool.
+    ws_task_t      *inject_head;
+    ws_task_t      *inject_tail;
+    atomic_int      inject_count;
+    semaphore_t     idle;          // Parked workers wait here.
+    atomic_int      sleepers;      // Parked workers that no one has woken yet.
+    atomic_int      stopping;
+    pthread_mutex_t sync_lock;     // Threads from outside the pool wait here for their groups.
+    pthread_cond_t  synced;
+} ws_pool_t;
+
+// Returns 0 or -1 if the threads or memory can't be had.
+int  ws_pool_init( ws_pool_t *pool, int worker_count );
+
+// All groups must have been synced. Waits for the workers to exit.
+void ws_pool_shutdown( ws_pool_t *pool );
+
+void ws_group_init( ws_group_t *group );
+void ws_spawn( ws_pool_t *pool, ws_group_t *group, ws_task_fn task, void *arg );
+void ws_sync( ws_pool_t *pool, ws_group_t *group );
+
+// Calls body on pieces of [begin, end) no longer than grain, in parallel, and waits for them all.
+void ws_parallel_for( ws_pool_t *pool, long begin, long end, long grain, ws_range_fn body, void *arg );
+
+#endif
@@ -0,0 +1,103 @@
+/****************************************************************************
+FILE    : ws_deque.c
+SUBJECT : Implementation of a Chase-Lev work stealing deque.
+AUTHOR  : (C) Copyright 2026 by Peter C. Chapin <pcc482719@gmail.com>
+
+The memory orderings are those of Le, Pop, Cohen and Zappa Nardelli,
+"Correct and Efficient Work-Stealing for Weak Memory Models" (PPoPP 2013).
+The sequentially consistent fences in take and steal make sure that when
+the owner and a thief go after the last item, at least one of them sees
+the other and the compare-and-swap on top picks the winner.
+****************************************************************************/
+
+#include <stdlib.h>
+#include "ws_deque.h"
+
+int ws_deque_init( ws_deque_t *d, int capacity )
+{
+    long size = 1;
+    long i;
+
+    while( size < capacity ) size <<= 1;
+    d->items = malloc( size * sizeof( *d->items ) );
+    if( d->items == NULL ) return -1;
+    for( i = 0; i < size; ++i ) {
+        atomic_init( &d->items[i], NULL );
+    }
+    d->mask = size - 1;
+    atomic_init( &d->top, 0 );
+    atomic_init( &d->bottom, 0 );
+    return 0;
+}
+
+
+void ws_deque_destroy( ws_deque_t *d )
+{
+    free( d->items );
+}
+
+
+int ws_deque_push( ws_deque_t *d, void *item )
+{
+    long b = atomic_load_explicit( &d->bottom, memory_order_relaxed );
+    long t = atomic_load_explicit( &d->top, memory_order_acquire );
+
+    if( b - t > d->mask ) return -1;
+    atomic_store_explicit( &d->items[b & d->mask], item, memory_order_relaxed );
+    atomic_thread_fence( memory_order_release );
+    atomic_store_explicit( &d->bottom, b + 1, memory_order_relaxed );
+    return 0;
+}
+
+
+void *ws_deque_take( ws_deque_t *d )
+{
+    long  b = atomic_load_explicit( &d->bottom, memory_order_relaxed ) - 1;
+    long  t;
+    void *item = NULL;
+
+    // Claim the bottom item before looking at top.
+    atomic_store_explicit( &d->bottom, b, memory_order_relaxed );
+    atomic_thread_fence( memory_order_seq_cst );
+    t = atomic_load_explicit( &d->top, memory_order_relaxed );
+
+    if( t <= b ) {
+        item = atomic_load_explicit( &d->items[b & d->mask], memory_order_relaxed );
+        if( t == b ) {
+            // The last item; thieves may be after it too.
+            if( !atomic_compare_exchange_strong_explicit(
+                    &d->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed ) ) item = NULL;
+            atomic_store_explicit( &d->bottom, b + 1, memory_order_relaxed );
+        }
+    }
+    else {
+        atomic_store_explicit( &d->bottom, b + 1, memory_order_relaxed );
+    }
+    return item;
+}
+
+
+void *ws_deque_steal( ws_deque_t *d )
+{
+    long  t = atomic_load_explicit( &d->top, memory_order_acquire );
+    long  b;
+    void *item;
+
+    atomic_thread_fence( memory_order_seq_cst );
+    b = atomic_load_explicit( &d->bottom, memory_order_acquire );
+    if( t >= b ) return NULL;
+
+    item = atomic_load_explicit( &d->items[t & d->mask], memory_order_relaxed );
+    if( !atomic_compare_exchange_strong_explicit(
+            &d->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed ) ) return NULL;
+    return item;
+}
+
+
+int ws_deque_empty( ws_deque_t *d )
+{
+    long t = atomic_load_explicit( &d->top, memory_order_acquire );
+    long b = atomic_load_explicit( &d->bottom, memory_order_acquire );
+
+    return t >= b;
+}
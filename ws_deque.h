@@ -0,0 +1,43 @@
+/****************************************************************************
+FILE    : ws_deque.h
+SUBJECT : Interface to a Chase-Lev work stealing deque.
+AUTHOR  : (C) Copyright 2026 by Peter C. Chapin <pcc482719@gmail.com>
+
+Each worker in a work stealing scheduler owns one of these deques. The
+owner pushes and takes work at the bottom end, like a stack, without any
+locking in the common case. Other threads steal from the top end, so they
+get the oldest (and usually biggest) pieces of work. Owner and thieves only
+synchronize over the very last item.
+
+This version has a fixed capacity. A push to a full deque fails and the
+caller is expected to run the work itself.
+****************************************************************************/
+
+#ifndef WS_DEQUE_H
+#define WS_DEQUE_H
+
+#include <stdatomic.h>
+#include "cache_line.h"
+
+typedef struct {
+    _Atomic(void *) *items;
+    long             mask;     // Capacity (a power of two) minus one.
+    _Alignas(CACHE_LINE_SIZE) atomic_long top;     // Next item to steal.
+    _Alignas(CACHE_LINE_SIZE) atomic_long bottom;  // Next free slot; only the owner writes it.
+} ws_deque_t;
+
+// The capacity is rounded up to a power of two. Returns 0 or -1 if memory runs out.
+int   ws_deque_init( ws_deque_t *d, int capacity );
+void  ws_deque_destroy( ws_deque_t *d );
+
+// Owner only. Push returns 0 or -1 if the deque is full. Take returns NULL if it is empty.
+int   ws_deque_push( ws_deque_t *d, void *item );
+void *ws_deque_take( ws_deque_t *d );
+
+// Any thread. Returns NULL if the deque is empty or another thread got the item first.
+void *ws_deque_steal( ws_deque_t *d );
+
+// Any thread. Only a hint, since the deque can change at any moment.
+int   ws_deque_empty( ws_deque_t *d );
+
+#endif